@@ -0,0 +1,25 @@
+#pragma once
+
+#ifndef ACCUMULATOR_HEADER_H_
+#define ACCUMULATOR_HEADER_H_
+
+/*
+	This file contains:
+		- Definition of Accumulator, the first layer of the network for a position.
+*/
+
+#include <array>
+#include <cstdint>
+
+/**
+	Output of the first layer of the network for both players, before
+	the activation. Every piece on the board adds its weights into it,
+	so a move only adds and subtracts the weights of the pieces it moves.
+*/
+struct alignas(32) Accumulator {
+	static constexpr int size = 256;
+
+	std::array<std::array<int16_t, size>, 2> values;	/**< Indexed by the Color it is seen by. */
+};
+
+#endif // ACCUMULATOR_HEADER_H_
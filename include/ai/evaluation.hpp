@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef EVALUATION_HEADER_H_
+#define EVALUATION_HEADER_H_
+
+/*
+	This file contains:
+		- Definition of TaperedScore, a score for the middlegame and one for the endgame.
+		- Declarations of the piece-square scores SearchPosition keeps up to date.
+		- Declaration of evaluate, the static evaluation of a position.
+*/
+
+#include "position.hpp"
+
+class PawnTable;
+
+/**
+	A score for the middlegame and one for the endgame, blended by the
+	material left on the board.
+*/
+struct TaperedScore {
+	int middlegame = 0;
+	int endgame = 0;
+
+	TaperedScore& operator+=(const TaperedScore& other) {
+		middlegame += other.middlegame;
+		endgame += other.endgame;
+		return *this;
+	}
+
+	TaperedScore& operator-=(const TaperedScore& other) {
+		middlegame -= other.middlegame;
+		endgame -= other.endgame;
+		return *this;
+	}
+
+	/**
+		Blend the scores by the phase, maxPhase is the middlegame, 0 the endgame.
+	*/
+	int blend(int phase) const;
+};
+
+/**
+	Phase of the starting position. Every piece left on the board adds its
+	phaseWeight, so the phase falls towards 0 as pieces are traded.
+*/
+constexpr int maxPhase = 24;
+
+/**
+	Get how much a piece counts towards the phase, pawns and kings count nothing.
+*/
+int phaseWeight(PieceType type);
+
+/**
+	Get the material and the piece-square score of a piece on a square,
+	from the view of white, so black pieces score negative.
+*/
+const TaperedScore& pieceSquareScore(piece_t piece, square_t square);
+
+/**
+	Evaluate a position statically, without searching any moves.
+
+	If the position uses a network, the network evaluates it. Otherwise
+	material and piece-square scores come from the position, which keeps
+	them up to date with every move. Mobility and king safety are worked
+	out on every call, pawn structure only when the pawn table does not
+	have it yet. None of them are when the score is so far outside of
+	the window that they could not bring it back in.
+
+	\param alpha Lowest score the caller is interested in.
+	\param beta Highest score the caller is interested in.
+	\param pawnTable Cache of pawn structures of the calling thread, can be nullptr.
+	\return Centipawns from the view of the player to move.
+*/
+int evaluate(const SearchPosition& position, int alpha = -32767, int beta = 32767,
+			 PawnTable* pawnTable = nullptr);
+
+#endif // EVALUATION_HEADER_H_
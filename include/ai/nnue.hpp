@@ -0,0 +1,92 @@
+#pragma once
+
+#ifndef NNUE_HEADER_H_
+#define NNUE_HEADER_H_
+
+/*
+	This file contains:
+		- Definition of Network, an efficiently updatable neural network
+		  that evaluates positions.
+*/
+
+#include "accumulator.hpp"
+#include "position.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+	An efficiently updatable neural network, 768 inputs to 2x256 hidden
+	neurons to 1 output.
+
+	Every input is a piece of some type and color on some square, seen once
+	from the side of every player. The player to move comes first in the
+	hidden layer, the hidden neurons are clipped into 0 to 255 before the output.
+
+	Weights are quantized, first layer weights to int16 and output weights
+	to int8, and loaded from a file:
+		- 4 bytes "CNUE", a uint32 version 1 and a uint32 hidden size of 256,
+		- int16 first layer weights, 256 for every input,
+		- int16 first layer biases, 256 of them,
+		- int8 output weights, 512 of them, and an int32 output bias.
+	All numbers are little-endian.
+
+	Accumulators are updated with AVX2 or SSE2 when the compiler targets them,
+	otherwise with plain loops.
+*/
+class Network {
+public:
+	static constexpr int inputs = 768;
+	static constexpr int hidden = Accumulator::size;
+private:
+	std::vector<int16_t> featureWeights;
+	std::vector<int16_t> featureBiases;
+	std::vector<int8_t> outputWeights;
+	int32_t outputBias = 0;
+
+	const int16_t* _weights(piece_t piece, square_t square, Color perspective) const;
+public:
+	/**
+		Load the weights of the network from a file.
+
+		\return False if the file cannot be read or is not a network,
+				the network is left unchanged then.
+	*/
+	bool load(const std::string& path);
+
+	bool isLoaded() const {
+		return !featureWeights.empty();
+	}
+
+	/**
+		Compute the accumulator of a position from its pieces.
+	*/
+	void refresh(Accumulator& accumulator, const SearchPosition& position) const;
+
+	/**
+		Update the accumulator with a piece placed on a square.
+	*/
+	void add(Accumulator& accumulator, piece_t piece, square_t square) const;
+
+	/**
+		Update the accumulator with a piece taken off a square.
+	*/
+	void remove(Accumulator& accumulator, piece_t piece, square_t square) const;
+
+	/**
+		Evaluate a position from its accumulator.
+
+		\param side Player to move.
+		\return Centipawns from the view of the player to move.
+	*/
+	int evaluate(const Accumulator& accumulator, Color side) const;
+
+	/**
+		Get the name of the instructions the accumulators are updated with.
+	*/
+	static const char* instructionSet();
+};
+
+#endif // NNUE_HEADER_H_
@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef PAWN_TABLE_HEADER_H_
+#define PAWN_TABLE_HEADER_H_
+
+/*
+	This file contains:
+		- Definition of PawnEntry, what evaluation knows about a pawn structure.
+		- Definition of PawnTable, a cache of pawn structures for a single thread.
+*/
+
+#include "evaluation.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+	What evaluation knows about a pawn structure, all of it depends
+	on the pawns alone.
+*/
+struct PawnEntry {
+	uint64_t key = 0;
+	std::array<uint64_t, 2> pawns = {};		/**< A bit for every square with a pawn, indexed by Color. */
+	std::array<uint64_t, 2> attacks = {};	/**< A bit for every square pawns attack, indexed by Color. */
+	TaperedScore score;						/**< Passed, doubled, isolated and backward pawns, from the view of white. */
+};
+
+/**
+	A fixed size cache of pawn structures, keyed by the pawn hash of positions.
+
+	Pawns move rarely, so most positions of a search share their pawn
+	structure with many others and find it here. The table is not shared,
+	every thread that evaluates should have its own.
+*/
+class PawnTable {
+	std::vector<PawnEntry> entries;
+	uint64_t probes = 0;
+	uint64_t hits = 0;
+public:
+	/**
+		\param kilobytes Size of the table, rounded down to a power of two entries.
+	*/
+	explicit PawnTable(size_t kilobytes = 512);
+
+	/**
+		Find the entry of a pawn structure.
+
+		\param key Pawn hash of the position.
+		\param found Set to whether the entry holds the structure already,
+					 if not the entry is the one to fill in.
+	*/
+	PawnEntry& probe(uint64_t key, bool& found);
+
+	/**
+		Drop all entries and reset the statistics.
+	*/
+	void clear();
+
+	size_t size() const {
+		return entries.size() * sizeof(PawnEntry);
+	}
+
+	/**
+		Get the share of probes that found their structure, from 0 to 1.
+	*/
+	double hitRate() const {
+		return probes ? static_cast<double>(hits) / probes : 0;
+	}
+};
+
+#endif // PAWN_TABLE_HEADER_H_
@@ -0,0 +1,28 @@
+#pragma once
+
+#ifndef PERFT_HEADER_H_
+#define PERFT_HEADER_H_
+
+/*
+	This file contains:
+		- Declaration of perft, which counts the leaf nodes of the move tree.
+*/
+
+#include "position.hpp"
+
+#include <cstdint>
+
+class TranspositionTable;
+
+/**
+	Count the positions reached after playing every sequence of legal moves
+	of a given length. Comparing the counts to known ones tests move generation.
+
+	\param position Position to count from, it is the same again on return.
+	\param depth Length of the move sequences, 0 counts only the position itself.
+	\param table If given, counts of positions already counted are reused from it.
+	\return Number of positions.
+*/
+uint64_t perft(SearchPosition& position, int depth, TranspositionTable* table = nullptr);
+
+#endif // PERFT_HEADER_H_
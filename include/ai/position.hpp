@@ -0,0 +1,383 @@
+#pragma once
+
+#ifndef SEARCH_POSITION_HEADER_H_
+#define SEARCH_POSITION_HEADER_H_
+
+/*
+	This file contains:
+		- Definition of Move, a single move as the search plays it.
+		- Definition of MoveList, a list of moves that never allocates.
+		- Definition of SearchPosition, a compact copy of a chess board
+		  that moves can be played on and taken back quickly.
+*/
+
+#include "accumulator.hpp"
+#include "../boardstate.hpp"
+#include "../piecetype.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GenericBoard;
+class Network;
+
+/**
+	Index of a square, rank * 8 + file. The first rank is the one white starts on.
+*/
+using square_t = int8_t;
+
+/**
+	A piece on a square, its type and color packed into a byte.
+	0 is an empty square, white pieces are type + 1, black pieces have bit 3 set too.
+*/
+using piece_t = uint8_t;
+
+constexpr piece_t noPiece = 0;
+
+inline constexpr piece_t makePiece(PieceType type, Color color) {
+	return static_cast<piece_t>((static_cast<int>(type) + 1) | (color == Color::Black ? 8 : 0));
+}
+
+inline constexpr PieceType pieceType(piece_t piece) {
+	return piece ? static_cast<PieceType>((piece & 7) - 1) : PieceType::None;
+}
+
+inline constexpr Color pieceColor(piece_t piece) {
+	return piece ? (piece & 8 ? Color::Black : Color::White) : Color::None;
+}
+
+inline constexpr Color opposite(Color color) {
+	return color == Color::White ? Color::Black : Color::White;
+}
+
+inline constexpr square_t toSquare(Position pos) {
+	return static_cast<square_t>(pos.first * 8 + pos.second);
+}
+
+inline constexpr Position toPosition(square_t square) {
+	return { static_cast<int8_t>(square / 8), static_cast<int8_t>(square % 8) };
+}
+
+/**
+	A single move, promotion is None for moves that do not promote.
+*/
+struct Move {
+	square_t from = -1;
+	square_t to = -1;
+	PieceType promotion = PieceType::None;
+
+	bool isNone() const {
+		return from < 0;
+	}
+
+	bool operator==(const Move& other) const {
+		return from == other.from && to == other.to && promotion == other.promotion;
+	}
+
+	bool operator!=(const Move& other) const {
+		return !(*this == other);
+	}
+
+	/**
+		Get the move in coordinate notation, such as e2e4 or e7e8q.
+	*/
+	std::string toString() const;
+};
+
+/**
+	A list of moves with room for any chess position, kept on the stack.
+*/
+class MoveList {
+	std::array<Move, 256> moves;
+	size_t count = 0;
+public:
+	void push(square_t from, square_t to, PieceType promotion = PieceType::None) {
+		moves[count++] = { from, to, promotion };
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+	Move& operator[](size_t idx) {
+		return moves[idx];
+	}
+
+	const Move& operator[](size_t idx) const {
+		return moves[idx];
+	}
+
+	Move* begin() {
+		return moves.data();
+	}
+
+	Move* end() {
+		return moves.data() + count;
+	}
+
+	const Move* begin() const {
+		return moves.data();
+	}
+
+	const Move* end() const {
+		return moves.data() + count;
+	}
+};
+
+/**
+	A chess position that moves can be played on and taken back again.
+
+	GenericBoard keeps the notation, the repetition table and the threats
+	of every square up to date after every move, which is what a game needs
+	but far too much for a search that plays millions of moves. This keeps
+	only the squares and the few flags the rules need, so a move costs
+	a few writes and taking it back restores them.
+*/
+class SearchPosition {
+public:
+	/**
+		Castling rights, one bit per side of the board per player.
+	*/
+	enum Castling : uint8_t {
+		WhiteKingSide = 1,
+		WhiteQueenSide = 2,
+		BlackKingSide = 4,
+		BlackQueenSide = 8,
+	};
+private:
+	/*
+		Everything a move changes that cannot be worked out from the move itself.
+	*/
+	struct Undo {
+		Move move;
+		piece_t moved;
+		piece_t captured;
+		square_t capturedOn;
+		uint8_t castling;
+		square_t enPassant;
+		int halfmove;
+		uint64_t hash;
+		uint64_t pawnHash;
+		int middlegame;
+		int endgame;
+		int phase;
+	};
+
+	std::array<piece_t, 64> squares = {};
+	std::array<square_t, 2> kings = { -1, -1 };		/**< Square of the king, indexed by Color. */
+	Color side = Color::White;
+	uint8_t castling = 0;
+	square_t enPassant = -1;		/**< Square a pawn skipped in the last move, -1 if none. */
+	int halfmove = 0;				/**< Moves since the last capture or pawn move. */
+	uint64_t key = 0;				/**< Zobrist hash, kept up to date by every move. */
+	uint64_t pawnKey = 0;			/**< Zobrist hash of the pawns alone. */
+
+	/*
+		Material and piece-square scores from the view of white, and the
+		phase, kept up to date by every move so evaluation does not add them up.
+	*/
+	int middlegame = 0;
+	int endgame = 0;
+	int phase = 0;
+
+	std::vector<Undo> history;
+	std::vector<uint64_t> gameHashes;	/**< Hashes of the positions of the game before the loaded one, the last one most recent. */
+
+	/*
+		With a network, accumulators of every position since the load,
+		the current one last.
+	*/
+	const Network* network = nullptr;
+	std::vector<Accumulator> accumulators;
+
+	void _generatePawn(square_t from, MoveList& list, bool quiets) const;
+	void _generateSliding(square_t from, const std::array<int, 2>* directions, int count,
+						  MoveList& list, bool quiets) const;
+	void _generateCastling(MoveList& list) const;
+	void _generate(MoveList& list, bool quiets) const;
+	void _computeHashes();
+	void _computeScores();
+	void _place(piece_t piece, square_t square);
+	void _remove(square_t square);
+public:
+	SearchPosition() = default;
+
+	/**
+		Keep the accumulators of a network up to date from the next load on.
+
+		\param network Network to evaluate with, nullptr to stop using one.
+	*/
+	void useNetwork(const Network* network);
+
+	const Network* evaluationNetwork() const {
+		return network;
+	}
+
+	/**
+		Get the accumulator of the current position, only valid with a network.
+	*/
+	const Accumulator& accumulator() const {
+		return accumulators.back();
+	}
+
+	/**
+		Copy the position of a chess board.
+
+		\param gameHashes Hashes of the positions played before it in the game, oldest first,
+						  so repetitions of them are found too.
+		\return False if the board is not an 8x8 board with one king of every color.
+	*/
+	bool load(const GenericBoard& board, const std::vector<uint64_t>& gameHashes = {});
+
+	piece_t at(square_t square) const {
+		return squares[square];
+	}
+
+	Color sideToMove() const {
+		return side;
+	}
+
+	uint8_t castlingRights() const {
+		return castling;
+	}
+
+	square_t enPassantSquare() const {
+		return enPassant;
+	}
+
+	int halfmoveClock() const {
+		return halfmove;
+	}
+
+	square_t kingSquare(Color color) const {
+		return kings[static_cast<int>(color)];
+	}
+
+	/**
+		Get the Zobrist hash of the position. Equal positions with the same
+		player to move, castling rights and en passant square hash the same,
+		no matter the moves that led to them.
+	*/
+	uint64_t hash() const {
+		return key;
+	}
+
+	/**
+		Get the material and piece-square score for the middlegame, from the view of white.
+	*/
+	int middlegameScore() const {
+		return middlegame;
+	}
+
+	/**
+		Get the material and piece-square score for the endgame, from the view of white.
+	*/
+	int endgameScore() const {
+		return endgame;
+	}
+
+	/**
+		Get how much material is left, from maxPhase in the opening to 0 with only pawns.
+	*/
+	int gamePhase() const {
+		return phase;
+	}
+
+	/**
+		Get the Zobrist hash of the pawns alone, positions with the same
+		pawns on the same squares hash the same.
+	*/
+	uint64_t pawnHash() const {
+		return pawnKey;
+	}
+
+	/**
+		Test whether the position was already reached since it was loaded,
+		or in the game before it. Only positions since the last capture or
+		pawn move are looked at, no earlier one can repeat.
+	*/
+	bool isRepetition() const;
+
+	/**
+		Number of moves played since the position was loaded.
+	*/
+	size_t played() const {
+		return history.size();
+	}
+
+	/**
+		Add all moves of the side to play into the list, including
+		those that leave its own king in check.
+	*/
+	void generate(MoveList& list) const;
+
+	/**
+		Add only captures, including en passant, and promotions to a queen
+		of the side to play into the list. Like generate, some of them may
+		leave its own king in check.
+	*/
+	void generateCaptures(MoveList& list) const;
+
+	/**
+		Add only legal moves of the side to play into the list.
+	*/
+	void generateLegal(MoveList& list);
+
+	/**
+		Play a move generated for this position.
+
+		\return False if the move would leave the king of the player in check,
+				the move is not played then.
+	*/
+	bool makeMove(const Move& move);
+
+	/**
+		Take back the last move played.
+	*/
+	void unmakeMove();
+
+	/**
+		Pass the turn to the other player without moving, which the rules
+		do not allow, but the search uses to test how good a position is.
+		Must not be played while in check.
+	*/
+	void makeNullMove();
+
+	/**
+		Take back the null move played last.
+	*/
+	void unmakeNullMove();
+
+	/**
+		Test whether a player has any piece other than pawns and the king.
+		Without one, zugzwang is common, so passing is no good test.
+	*/
+	bool hasNonPawnMaterial(Color color) const;
+
+	/**
+		Test whether a player attacks a square.
+	*/
+	bool isAttacked(square_t square, Color byColor) const;
+
+	/**
+		Work out what a capture wins once all captures on its square that
+		pay off for either player are played, cheapest attacker first.
+		Pieces lined up behind others are counted as soon as they are uncovered.
+
+		\param move Move generated for this position, usually a capture.
+		\return Material won in centipawns by the player to move,
+				negative if the move loses material.
+	*/
+	int staticExchange(const Move& move) const;
+
+	/**
+		Test whether the king of the side to play is in check.
+	*/
+	bool inCheck() const {
+		return isAttacked(kingSquare(side), opposite(side));
+	}
+};
+
+#endif // SEARCH_POSITION_HEADER_H_
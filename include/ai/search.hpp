@@ -0,0 +1,242 @@
+#pragma once
+
+#ifndef SEARCH_HEADER_H_
+#define SEARCH_HEADER_H_
+
+/*
+	This file contains:
+		- Definition of SearchLimits, the budget of a single search.
+		- Definition of SearchResult, what a search found.
+		- Definition of Search, a negamax alpha-beta search with iterative
+		  deepening and principal variation search.
+		- Declaration of playMove, which plays a found move on a board.
+*/
+
+#include "pawntable.hpp"
+#include "position.hpp"
+#include "timemanager.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class GenericBoard;
+class TranspositionTable;
+class Network;
+
+/**
+	Techniques that let the search skip or cut short moves that are unlikely
+	to matter, each can be turned off on its own to measure what it brings.
+*/
+struct SearchFeatures {
+	bool nullMove = true;			/**< Pass the turn, a position still good after that needs no full search. */
+	bool lateMoveReductions = true;	/**< Search quiet moves ordered late less deep, unless they turn out good. */
+	bool futility = true;			/**< Skip quiet moves near the leaves that cannot bring the score up to alpha. */
+	bool razoring = true;			/**< Drop straight into the quiescence search when far below alpha near the leaves. */
+	bool checkExtensions = true;	/**< Search a ply deeper when in check. */
+};
+
+/**
+	Budget of a single search. The search stops at whichever limit it reaches first.
+*/
+struct SearchLimits {
+	int depth = 64;			/**< Deepest iteration to search. */
+	uint64_t nodes = 0;		/**< Nodes to search at most over all threads, 0 for no limit. */
+	int64_t time = 0;		/**< Milliseconds to search at most, 0 for no limit. */
+	int threads = 1;		/**< Threads to search on, more than one needs a transposition table. */
+	int multiPv = 1;		/**< Best moves to find, every one with its own line. */
+	GameClock clock;		/**< Clock of the player to move, the time manager decides when to stop. */
+};
+
+/**
+	A line found by a search, one of the best moves and how the game continues after it.
+*/
+struct PvLine {
+	int score = 0;				/**< Centipawns from the view of the player to move. */
+	std::vector<Move> pv;		/**< Starting with the move the line is about. */
+};
+
+/**
+	Best line found by a search, after any completed iteration.
+*/
+struct SearchResult {
+	Move best;					/**< None if the player to move has no legal move. */
+	int score = 0;				/**< Centipawns from the view of the player to move. */
+	int depth = 0;				/**< Depth of the last completed iteration. */
+	uint64_t nodes = 0;			/**< Nodes searched so far, over all iterations and threads. */
+	double seconds = 0;
+	std::vector<Move> pv;		/**< Principal variation, starting with the best move. */
+	std::vector<PvLine> lines;	/**< Best lines with different first moves, the best first, as many as multiPv asked for. */
+
+	uint64_t cutoffs = 0;			/**< Beta cutoffs of the main thread. */
+	uint64_t firstMoveCutoffs = 0;	/**< Beta cutoffs made by the first move searched. */
+	double pawnHitRate = 0;			/**< Share of pawn table probes of the main thread that hit. */
+
+	double nodesPerSecond() const {
+		return seconds > 0 ? nodes / seconds : 0;
+	}
+
+	/**
+		Get the share of cutoffs made by the first move searched, from 0 to 1.
+		The closer to 1, the better the moves are ordered.
+	*/
+	double firstMoveCutoffRate() const {
+		return cutoffs ? static_cast<double>(firstMoveCutoffs) / cutoffs : 0;
+	}
+};
+
+/**
+	Called after every completed iteration with the best line so far.
+*/
+using SearchCallback = std::function<void(const SearchResult& result)>;
+
+/**
+	Searches for the best move of the player to move on a board.
+
+	The search runs iterative deepening, every iteration is a negamax
+	alpha-beta search one ply deeper than the last one. The principal variation
+	of the previous iteration is searched first, and all other moves are first
+	searched with a null window, only searched again with the full window
+	if they turn out to be better.
+
+	The search is selective, with every technique of SearchFeatures on
+	by default. Near the leaves, moves and whole positions far from the
+	window are pruned. Quiet moves ordered late are searched less deep.
+	A position that is still above beta after passing the turn is cut
+	off after a shallow search. Checks are searched a ply deeper.
+
+	With multiPv above one, every iteration searches the root once per line.
+	Each search leaves out the root moves of the lines found before it, so
+	it finds the best of the remaining moves. All of them share the
+	transposition table and move ordering, so the later ones are much
+	cheaper than separate searches would be.
+
+	With more than one thread the search runs Lazy SMP. Helper threads
+	search the same position on their own, every other one a ply deeper than
+	the main thread and each with its moves in a slightly different order.
+	They only share the transposition table, so what a helper finds first
+	makes the main thread faster. Only the main thread watches the limits
+	and reports its best line, helpers stop once it is done.
+
+	The board itself is never changed, the search plays on its own
+	SearchPosition. A single Search can only run one search at a time,
+	but any number of Search objects can run on different threads.
+*/
+class Search {
+public:
+	static constexpr int maxPly = 128;
+	static constexpr int mateScore = 32000;		/**< Score of a mate on the board, minus plies to reach it. */
+	static constexpr int infinity = 32767;
+private:
+	using clock_t = std::chrono::steady_clock;
+
+	SearchPosition position;
+	TranspositionTable* table;
+	const Network* network = nullptr;
+	PawnTable pawnTable;
+	SearchLimits limits;
+	SearchFeatures features;
+	TimeManager timeManager;
+	int64_t deadline = 0;		/**< Milliseconds to stop at, from the time limit or the clock, 0 for none. */
+	clock_t::time_point start;
+	uint64_t nodes = 0;
+	int iteration = 0;
+	std::atomic<bool> stopped = false;
+
+	int helperIndex = 0;					/**< 0 for the main thread. */
+	std::atomic<uint64_t> publishedNodes = 0;	/**< Nodes, as seen by other threads. */
+	std::vector<std::unique_ptr<Search>> helpers;
+
+	/*
+		Triangular table of principal variations, row ply holds the best line
+		found from that ply on.
+	*/
+	std::array<std::array<Move, maxPly>, maxPly> pvTable;
+	std::array<int, maxPly> pvLength = {};
+
+	std::vector<Move> previousPv;
+	bool followPv = false;
+
+	std::vector<PvLine> previousLines;	/**< Lines of the last completed iteration. */
+	std::vector<Move> excludedRoot;		/**< Root moves whose lines were already found in this iteration. */
+
+	std::array<std::array<Move, 2>, maxPly> killers = {};
+	std::array<std::array<std::array<int, 64>, 64>, 2> history = {};	/**< Indexed by Color, from and to. */
+	uint64_t cutoffs = 0;
+	uint64_t firstMoveCutoffs = 0;
+
+	int _negamax(int depth, int alpha, int beta, int ply, bool allowNull = true);
+	int _quiescence(int alpha, int beta, int ply);
+	bool _isCapture(const Move& move) const;
+	void _scoreMoves(const MoveList& moves, std::array<int, 256>& scores, int ply, const Move& hashMove);
+	void _updateQuiet(const Move& move, int depth, int ply);
+	bool _outOfBudget();
+	double _elapsed() const;
+	uint64_t _totalNodes() const;
+	void _runHelper();
+public:
+	/**
+		\param table Table to share what was found with other searches, can be nullptr.
+					 It must outlive the search.
+	*/
+	explicit Search(TranspositionTable* table = nullptr)
+		: table(table) {}
+
+	/**
+		Evaluate positions with a network instead of the hand-written evaluation.
+
+		\param network Loaded network that outlives the searches, nullptr to stop using one.
+	*/
+	void useNetwork(const Network* network) {
+		this->network = network;
+	}
+
+	/**
+		Choose the selective techniques of the next searches, all are used by default.
+	*/
+	void useFeatures(const SearchFeatures& features) {
+		this->features = features;
+	}
+
+	/**
+		Search for the best move.
+
+		\param board Board to search, it is not changed.
+		\param limits When to stop searching, the first iteration is always completed
+					  unless the clock runs out.
+		\param onIteration Called after every completed iteration, can be nullptr.
+		\param gameHashes Hashes of the positions played before the board in the game,
+						  oldest first, so the search sees repetitions of them.
+		\return Best line of the deepest completed iteration.
+	*/
+	SearchResult run(const GenericBoard& board, const SearchLimits& limits,
+					 const SearchCallback& onIteration = nullptr,
+					 const std::vector<uint64_t>& gameHashes = {});
+
+	/**
+		Stop a running search from another thread, it returns as soon as it notices.
+	*/
+	void stop() {
+		stopped = true;
+	}
+};
+
+/**
+	Play a move found by a search on the board it was found for.
+
+	\return False if the move cannot be played.
+*/
+bool playMove(GenericBoard& board, const Move& move);
+
+/**
+	Format a score for printing, centipawns as pawns, such as +0.35,
+	mates as #3 or #-2 in moves.
+*/
+std::string scoreToString(int score);
+
+#endif // SEARCH_HEADER_H_
@@ -0,0 +1,73 @@
+#pragma once
+
+#ifndef TIME_MANAGER_HEADER_H_
+#define TIME_MANAGER_HEADER_H_
+
+/*
+	This file contains:
+		- Definition of GameClock, the clock of the player to move.
+		- Definition of TimeManager, which splits the time on the clock
+		  between the moves of a game.
+*/
+
+#include "position.hpp"
+
+#include <cstdint>
+
+/**
+	The clock of the player to move, all times in milliseconds.
+*/
+struct GameClock {
+	int64_t time = 0;			/**< Time left on the clock, 0 for no clock. */
+	int64_t increment = 0;		/**< Time added after every move. */
+	int movesToGo = 0;			/**< Moves until the next time control, 0 if the rest of the game has to be played. */
+	int64_t overhead = 30;		/**< Time lost outside of the search on every move, to the GUI or the network. */
+};
+
+/**
+	Splits the time on the clock between the moves of a game.
+
+	Every move gets two deadlines. No new iteration is started after the
+	soft one, and the search is stopped on the spot at the hard one. The soft
+	deadline moves with the search: when the best move stays the same
+	iteration after iteration it comes sooner, when the best move keeps
+	changing it is pushed back, but never past the hard one.
+*/
+class TimeManager {
+	int64_t soft = 0;
+	int64_t hard = 0;
+
+	Move lastBest;
+	int stableIterations = 0;
+	double instability = 0;		/**< Changes of the best move, older ones count less. */
+public:
+	/**
+		Work out the deadlines of a move.
+	*/
+	void start(const GameClock& clock);
+
+	/**
+		Milliseconds after which no new iteration should start, before any adjustment.
+	*/
+	int64_t softLimit() const {
+		return soft;
+	}
+
+	/**
+		Milliseconds after which the search must stop.
+	*/
+	int64_t hardLimit() const {
+		return hard;
+	}
+
+	/**
+		Tell the manager an iteration finished.
+
+		\param best Best move found by the iteration.
+		\param elapsed Milliseconds since the search started.
+		\return True if another iteration should be started.
+	*/
+	bool iterationDone(const Move& best, double elapsed);
+};
+
+#endif // TIME_MANAGER_HEADER_H_
@@ -0,0 +1,181 @@
+#pragma once
+
+#ifndef TRANSPOSITION_TABLE_HEADER_H_
+#define TRANSPOSITION_TABLE_HEADER_H_
+
+/*
+	This file contains:
+		- Definition of Bound, what a stored score says about the real one.
+		- Definition of TTEntry, a single entry of the table.
+		- Definition of TranspositionTable, a fixed size cache of positions
+		  shared by any number of threads without locks.
+*/
+
+#include "position.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+	What a stored score says about the real score of the position.
+*/
+enum class Bound : uint8_t {
+	None,
+	Exact,
+	Lower,		/**< The real score is at least the stored one, the search failed high. */
+	Upper,		/**< The real score is at most the stored one, the search failed low. */
+};
+
+/**
+	A single entry of the table.
+
+	Besides the depth and bound, every entry carries 48 bits of payload.
+	Searches store the best move, the score and the static evaluation, if they
+	computed one, in it. Perft stores the number of nodes.
+*/
+struct TTEntry {
+	uint64_t payload = 0;
+	int depth = 0;
+	Bound bound = Bound::None;
+
+	static constexpr uint64_t payloadMask = (1ull << 48) - 1;
+
+	/**
+		Pack what a search knows about a position into a payload.
+	*/
+	static uint64_t packSearch(const Move& move, int score, int eval) {
+		uint64_t packedMove = move.isNone() ? 0
+			: (static_cast<uint64_t>(move.from) | static_cast<uint64_t>(move.to) << 6
+			   | static_cast<uint64_t>(move.promotion) << 12 | 1ull << 15);
+		return packedMove | static_cast<uint64_t>(static_cast<uint16_t>(score)) << 16
+			| static_cast<uint64_t>(static_cast<uint16_t>(eval)) << 32;
+	}
+
+	Move move() const {
+		if (!(payload & (1ull << 15)))	return {};
+		return { static_cast<square_t>(payload & 63), static_cast<square_t>(payload >> 6 & 63),
+				 static_cast<PieceType>(payload >> 12 & 7) };
+	}
+
+	int score() const {
+		return static_cast<int16_t>(payload >> 16 & 0xFFFF);
+	}
+
+	int eval() const {
+		return static_cast<int16_t>(payload >> 32 & 0xFFFF);
+	}
+};
+
+/**
+	A fixed size table of positions, keyed by their 64-bit hashes.
+
+	The table is divided into buckets of four entries, one cache line each.
+	A position can only be stored in the bucket its hash points at, so when
+	the bucket is full the entry from the oldest search with the shallowest
+	depth makes room.
+
+	Any number of threads can probe and store at the same time without locks.
+	Every entry is stored as two 64-bit words, the data and the hash XORed
+	with the data. An entry torn by two threads writing it at once no longer
+	matches its hash, so it reads as a miss instead of as wrong data.
+*/
+class TranspositionTable {
+	/*
+		Both words are atomic only so that concurrent access is defined,
+		they are read and written relaxed.
+	*/
+	struct Slot {
+		std::atomic<uint64_t> check{ 0 };	/**< Hash XOR data. */
+		std::atomic<uint64_t> data{ 0 };	/**< Payload, bound, generation and depth. */
+	};
+
+	struct alignas(64) Bucket {
+		std::array<Slot, 4> slots;
+	};
+
+	/*
+		Counters of probes and hits, spread over cache lines so that threads
+		do not fight over a single one.
+	*/
+	struct alignas(64) Counters {
+		std::atomic<uint64_t> probes{ 0 };
+		std::atomic<uint64_t> hits{ 0 };
+	};
+
+	std::unique_ptr<Bucket[]> buckets;
+	size_t bucketCount = 0;
+	std::atomic<uint8_t> generation{ 0 };
+	std::array<Counters, 16> counters;
+
+	Bucket& _bucket(uint64_t key) const;
+	Counters& _counters();
+public:
+	/**
+		\param megabytes Size of the table, at least one bucket is always allocated.
+	*/
+	explicit TranspositionTable(size_t megabytes = 16);
+
+	/**
+		Reallocate the table with a new size, dropping all entries.
+		Must not be called while other threads use the table.
+	*/
+	void resize(size_t megabytes);
+
+	/**
+		Drop all entries and reset the statistics.
+		Must not be called while other threads use the table.
+	*/
+	void clear();
+
+	/**
+		Start a new search, entries of older searches are replaced first.
+	*/
+	void newSearch() {
+		generation.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/**
+		Look a position up.
+
+		\param key Hash of the position.
+		\param entry Filled in if the position was found.
+		\return True if the position was found.
+	*/
+	bool probe(uint64_t key, TTEntry& entry);
+
+	/**
+		Store a position, replacing an older or shallower entry of the bucket.
+
+		\param key Hash of the position.
+		\param depth Depth the payload was found with, 0 to 255.
+	*/
+	void store(uint64_t key, int depth, Bound bound, uint64_t payload);
+
+	/**
+		Prefetch the bucket of a position, so a later probe does not wait on memory.
+	*/
+	void prefetch(uint64_t key) const;
+
+	size_t size() const {
+		return bucketCount * sizeof(Bucket);
+	}
+
+	/**
+		Get the share of probes that found their position, from 0 to 1.
+	*/
+	double hitRate() const;
+
+	uint64_t probes() const;
+	uint64_t hits() const;
+
+	/**
+		Estimate how full the table is, from the first thousand entries.
+
+		\return Entries per thousand that were stored by the current search.
+	*/
+	int permilleFull() const;
+};
+
+#endif // TRANSPOSITION_TABLE_HEADER_H_
@@ -0,0 +1,314 @@
+#pragma once
+
+#ifndef MONTE_CARLO_TREE_HEADER_H_
+#define MONTE_CARLO_TREE_HEADER_H_
+
+/*
+	This file contains:
+		- Definition of NodePool, a fixed size arena of tree nodes and their
+		  edges, shared by any number of threads without locks.
+		- Definition of MctsLimits, the budget and settings of a single search.
+		- Definition of MctsResult, what a search found.
+		- Definition of MonteCarloSearch, a Monte Carlo tree search with
+		  UCT selection and random or heuristic rollouts, on any number of
+		  threads sharing one tree.
+*/
+
+#include "pawntable.hpp"
+#include "position.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+class GenericBoard;
+class Network;
+
+/**
+	A fixed size arena of tree nodes and the edges between them.
+
+	Nodes and edges live in two arrays allocated once, new ones are taken
+	from the front of the unused part. The edges of a node are a contiguous
+	run of the edge array, so a node only keeps where its run starts and how
+	long it is. Nothing is ever freed on its own, clearing the pool for
+	the next search only resets the two counts.
+
+	Any number of threads can allocate, read and update at the same time.
+	Allocating only bumps an atomic count. Counters of nodes are atomic, and
+	a node is published to other threads through the release store of its
+	state or of the edge that leads to it, after it is fully written.
+*/
+class NodePool {
+public:
+	static constexpr uint32_t noNode = 0xFFFFFFFF;
+
+	/**
+		State of a node, whether its edges are known and how the game ended in it.
+	*/
+	enum class NodeState : uint8_t {
+		Leaf,			/**< Edges not generated yet. */
+		Expanding,		/**< A thread is generating the edges. */
+		Expanded,
+		Lost,			/**< The player to move is mated. */
+		Drawn,			/**< Stalemate, fifty moves or repetition. */
+	};
+
+	/**
+		A move from a node, and the node it leads to once it was tried.
+	*/
+	struct Edge {
+		Move move;
+		std::atomic<uint32_t> child{ noNode };
+	};
+
+	/**
+		A position of the tree. The value is the sum of the results of all
+		playouts through it, from the view of the player who moved into it,
+		in units of 1 / valueScale.
+	*/
+	struct Node {
+		uint32_t firstEdge = 0;
+		uint16_t edgeCount = 0;
+		std::atomic<NodeState> state{ NodeState::Leaf };
+		std::atomic<uint32_t> visits{ 0 };
+		std::atomic<uint64_t> value{ 0 };
+
+		/**
+			Get the mean result of the playouts through the node, from 0 to 1.
+		*/
+		double meanValue() const {
+			auto count = visits.load(std::memory_order_relaxed);
+			return count ? static_cast<double>(value.load(std::memory_order_relaxed)) / valueScale / count : 0;
+		}
+	};
+
+	static constexpr double valueScale = 65536;
+private:
+	std::unique_ptr<Node[]> nodes;
+	std::unique_ptr<Edge[]> edges;
+	size_t nodeCapacity = 0;
+	size_t edgeCapacity = 0;
+	std::atomic<size_t> nodeCount{ 0 };
+	std::atomic<size_t> edgeCount{ 0 };
+public:
+	/**
+		\param megabytes Memory of nodes and edges together, most of it goes to edges.
+	*/
+	explicit NodePool(size_t megabytes = 256);
+
+	/**
+		Reallocate the pool with a new size, dropping all nodes.
+	*/
+	void resize(size_t megabytes);
+
+	/**
+		Drop all nodes and edges, without touching their memory.
+		Must not be called while other threads use the pool.
+	*/
+	void clear() {
+		nodeCount = 0;
+		edgeCount = 0;
+	}
+
+	/**
+		Take a fresh node from the pool.
+
+		\return Index of the node, noNode if the pool is full.
+	*/
+	uint32_t allocateNode();
+
+	/**
+		Give a node one edge for every move of a list. Only the thread
+		expanding the node may call it, others see the edges once the
+		node is marked as expanded.
+
+		\return False if the pool has no room for them, the node is left unchanged.
+	*/
+	bool allocateEdges(Node& node, const MoveList& moves);
+
+	Node& node(uint32_t index) {
+		return nodes[index];
+	}
+
+	const Node& node(uint32_t index) const {
+		return nodes[index];
+	}
+
+	Edge& edge(uint32_t index) {
+		return edges[index];
+	}
+
+	const Edge& edge(uint32_t index) const {
+		return edges[index];
+	}
+
+	/*
+		The counts go past the capacity once allocations start failing.
+	*/
+	size_t nodesUsed() const {
+		return std::min(nodeCount.load(std::memory_order_relaxed), nodeCapacity);
+	}
+
+	size_t edgesUsed() const {
+		return std::min(edgeCount.load(std::memory_order_relaxed), edgeCapacity);
+	}
+
+	/**
+		Get the bytes of memory taken by the nodes and edges in use.
+	*/
+	size_t memoryUsed() const {
+		return nodesUsed() * sizeof(Node) + edgesUsed() * sizeof(Edge);
+	}
+};
+
+/**
+	How playouts play on from the position where they leave the tree.
+*/
+enum class Rollout : uint8_t {
+	Random,			/**< Uniformly random legal moves. */
+	Heuristic,		/**< A capture that does not lose material if there is one, random moves otherwise. */
+};
+
+/**
+	Budget and settings of a single search. The search stops at whichever limit it reaches first.
+*/
+struct MctsLimits {
+	uint64_t playouts = 0;			/**< Playouts to run at most, 0 for no limit. */
+	int64_t time = 0;				/**< Milliseconds to search at most, 0 for no limit. */
+	double exploration = 1.4;		/**< Weight of the exploration term of UCT. */
+	Rollout rollout = Rollout::Heuristic;
+	int rolloutPlies = 8;			/**< Moves a playout plays before the evaluation decides its result. */
+	int threads = 1;				/**< Threads running playouts on the shared tree. */
+	int virtualLoss = 3;			/**< Lost visits a node counts while a playout through it runs. */
+};
+
+/**
+	Statistics of a move of the root.
+*/
+struct MctsMove {
+	Move move;
+	uint32_t visits = 0;
+	double winRate = 0;				/**< Mean result of its playouts for the player to move, from 0 to 1. */
+};
+
+/**
+	What a search found.
+*/
+struct MctsResult {
+	Move best;						/**< None if the player to move has no legal move. */
+	double winRate = 0.5;			/**< Mean result of the playouts of the best move. */
+	uint64_t playouts = 0;
+	std::vector<uint64_t> threadPlayouts;	/**< Playouts run by every thread. */
+	size_t nodes = 0;				/**< Nodes of the tree. */
+	size_t memory = 0;				/**< Bytes taken by the tree. */
+	double seconds = 0;
+	std::vector<Move> pv;			/**< Most visited line, starting with the best move. */
+	std::vector<MctsMove> moves;	/**< All root moves, the most visited first. */
+
+	double playoutsPerSecond() const {
+		return seconds > 0 ? playouts / seconds : 0;
+	}
+
+	/**
+		Get the playouts per second of a single thread on average, which stays
+		the same as threads are added as long as they scale perfectly.
+	*/
+	double playoutsPerSecondPerThread() const {
+		return threadPlayouts.size() ? playoutsPerSecond() / threadPlayouts.size() : 0;
+	}
+};
+
+/**
+	Searches for the best move with Monte Carlo tree search.
+
+	Every playout walks down the tree from the root, picking the child with
+	the best upper confidence bound (UCT), until it reaches a move never tried
+	before. That move gets a node, and the playout plays on from it with
+	rollout moves for a few plies, then the static evaluation turns the
+	position into a result between 0 and 1. The result is added to all nodes
+	on the way back up. The edges of a node are only generated once a playout
+	passes through it a second time, so most nodes never take any.
+
+	All nodes come from a NodePool that is cleared for every search, there is
+	no allocation during a search. Once the pool is full the tree stops
+	growing and playouts start their rollouts where the tree ends.
+
+	With more than one thread, all threads run playouts on the same tree.
+	No locks are taken: counters are added to atomically, and a node is
+	expanded by whichever thread claims it first, others play out from it
+	meanwhile. A playout counts as virtualLoss lost visits in every node on
+	its path until its result is known, so threads going down at the same
+	time see the path as worse and spread over different branches.
+
+	The best move is the most visited one. The board itself is never changed,
+	every thread plays on its own SearchPosition.
+*/
+class MonteCarloSearch {
+	using clock_t = std::chrono::steady_clock;
+
+	/*
+		What every thread keeps to itself.
+	*/
+	struct Worker {
+		SearchPosition position;
+		PawnTable pawnTable;
+		std::mt19937_64 random;
+		std::vector<uint32_t> path;
+		uint64_t playouts = 0;
+	};
+
+	NodePool pool;
+	SearchPosition root;
+	uint64_t seed;
+	const Network* network = nullptr;
+	MctsLimits limits;
+	clock_t::time_point start;
+	std::atomic<bool> stopped = false;
+	std::atomic<uint64_t> startedPlayouts = 0;
+
+	uint32_t _select(uint32_t index) const;
+	bool _expand(Worker& worker, NodePool::Node& node);
+	double _rollout(Worker& worker);
+	bool _playRollout(Worker& worker);
+	void _playout(Worker& worker);
+	void _runWorker(Worker& worker);
+	double _elapsed() const;
+public:
+	/**
+		\param megabytes Size of the node pool.
+		\param seed Seed of the rollouts, equal seeds play equal searches on a single thread.
+	*/
+	explicit MonteCarloSearch(size_t megabytes = 256, uint64_t seed = 1)
+		: pool(megabytes), seed(seed) {}
+
+	/**
+		Judge the positions where rollouts end with a network instead of the hand-written evaluation.
+
+		\param network Loaded network that outlives the searches, nullptr to stop using one.
+	*/
+	void useNetwork(const Network* network) {
+		this->network = network;
+	}
+
+	/**
+		Search for the best move.
+
+		\param board Board to search, it is not changed.
+		\param limits When to stop searching, at least one playout is always run.
+		\return Statistics of the root moves.
+	*/
+	MctsResult run(const GenericBoard& board, const MctsLimits& limits);
+
+	/**
+		Stop a running search from another thread, it returns as soon as it notices.
+	*/
+	void stop() {
+		stopped = true;
+	}
+};
+
+#endif // MONTE_CARLO_TREE_HEADER_H_
@@ -0,0 +1,99 @@
+#pragma once
+
+#ifndef BENCHMARK_HEADER_H_
+#define BENCHMARK_HEADER_H_
+
+/*
+	This file contains:
+		- Definition of Benchmark, a single named microbenchmark.
+		- Definition of BenchmarkResult, timings measured for one benchmark.
+		- Definition of BenchmarkRunner, which measures registered benchmarks
+		  and reports them as a table or as JSON.
+*/
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <ostream>
+
+/**
+	A single named microbenchmark.
+
+	The measured operation is run, one call at a time, many times in a row.
+	If setup is provided, it runs untimed before every call of run,
+	for operations that change the state they run over, such as moves.
+	Without setup, calls are timed in batches, so that even operations
+	shorter than the resolution of the clock are measured precisely.
+*/
+struct Benchmark {
+	std::string name;
+	std::function<void()> run;
+	std::function<void()> setup = nullptr;
+};
+
+/**
+	Timings of a single benchmark, all of them in nanoseconds per operation.
+*/
+struct BenchmarkResult {
+	std::string name;
+	size_t samples = 0;			/**< Number of timed samples. */
+	size_t opsPerSample = 0;	/**< Number of operations in every sample. */
+	double mean = 0;
+	double median = 0;
+	double min = 0;
+	double max = 0;
+	double stddev = 0;
+};
+
+/**
+	Measures registered benchmarks in order of registration.
+
+	Every benchmark is first warmed up, then timed in a fixed number of samples,
+	so runs of the same build over the same positions are repeatable.
+*/
+class BenchmarkRunner {
+	std::vector<Benchmark> benchmarks;
+
+	size_t warmup = 50;					/**< Untimed operations before the samples. */
+	size_t samples = 200;				/**< Timed samples per benchmark. */
+	long long minSampleNs = 20'000;		/**< Batched samples take at least this long. */
+
+	BenchmarkResult _measure(const Benchmark& benchmark) const;
+public:
+	void add(Benchmark benchmark);
+
+	/**
+		Get names of all registered benchmarks.
+	*/
+	std::vector<std::string> names() const;
+
+	void warmupIterations(size_t count) {
+		warmup = count;
+	}
+
+	void sampleCount(size_t count) {
+		samples = count ? count : 1;
+	}
+
+	/**
+		Run all benchmarks whose name contains the filter.
+
+		\param filter Substring of names to run, all benchmarks run when empty.
+		\param progress Stream to print every result into as soon as it is measured,
+				can be nullptr.
+		\return Results in order in which the benchmarks were registered.
+	*/
+	std::vector<BenchmarkResult> run(const std::string& filter, std::ostream* progress) const;
+};
+
+/**
+	Format results into a table, one row per benchmark.
+*/
+std::string formatResults(const std::vector<BenchmarkResult>& results);
+
+/**
+	Format results as JSON, an object with a single array "benchmarks".
+*/
+std::string resultsToJSON(const std::vector<BenchmarkResult>& results);
+
+#endif // BENCHMARK_HEADER_H_
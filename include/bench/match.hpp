@@ -0,0 +1,79 @@
+#pragma once
+
+#ifndef MATCH_HEADER_H_
+#define MATCH_HEADER_H_
+
+/*
+	This file contains:
+		- Definition of MatchResult, the totals of a match between two engines.
+		- Declaration of playMatch, which plays engines with different search
+		  features against each other on multiple threads.
+*/
+
+#include "../ai/search.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+	Totals of a match, from the view of the first engine.
+*/
+struct MatchResult {
+	size_t games = 0;
+	size_t wins = 0;
+	size_t draws = 0;			/**< Unfinished games count as draws too. */
+	size_t losses = 0;
+	size_t unfinished = 0;		/**< Games stopped after reaching the ply limit. */
+	size_t plies = 0;
+	int threads = 0;
+	double seconds = 0;
+
+	/**
+		Get the share of points the first engine scored, from 0 to 1.
+	*/
+	double score() const {
+		return games ? (wins + draws / 2.0) / games : 0.5;
+	}
+
+	/**
+		Get the Elo difference the score stands for, positive if the first engine is stronger.
+	*/
+	double eloDifference() const;
+
+	/**
+		Get half the width of the 95% confidence interval of eloDifference.
+	*/
+	double eloMargin() const;
+};
+
+/**
+	Play a match between two engines that differ only in their search features.
+
+	Every opening is played twice, once with either engine on white, so
+	the openings do not favor one of them. Every move is searched to a fixed
+	number of nodes, so the match measures what the features bring for the
+	same work and comes out the same on any machine and any load.
+	Game i is always played from opening i / 2, whichever thread plays it.
+
+	\param first Features of the first engine, results are from its view.
+	\param second Features of the second engine.
+	\param openings Positions in Forsyth-Edwards Notation to start the games
+			from, used in turn when there are more games than openings.
+	\param games Number of games to play, best even.
+	\param nodes Nodes every move is searched for.
+	\param threads Number of threads to play games on, every game runs on one.
+	\param maxPlies Games that reach this many moves are stopped and
+			counted as drawn.
+	\return Totals of all games.
+*/
+MatchResult playMatch(const SearchFeatures& first, const SearchFeatures& second,
+					  const std::vector<std::string>& openings, size_t games,
+					  uint64_t nodes, int threads, size_t maxPlies = 300);
+
+/**
+	Format the result into a single line report.
+*/
+std::string formatMatch(const MatchResult& result);
+
+#endif // MATCH_HEADER_H_
@@ -0,0 +1,73 @@
+#pragma once
+
+#ifndef SELF_PLAY_HEADER_H_
+#define SELF_PLAY_HEADER_H_
+
+/*
+	This file contains:
+		- Definition of SelfPlayResult, totals of a self-play run.
+		- Declaration of runSelfPlay, which plays random games to completion
+		  on multiple threads.
+*/
+
+#include "../boards/genericboard.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/**
+	Totals of a self-play run, summed over all threads.
+*/
+struct SelfPlayResult {
+	static constexpr size_t endCount = static_cast<size_t>(GameEnd::Forfeit) + 1;
+
+	size_t games = 0;
+	size_t plies = 0;
+	size_t unfinished = 0;		/**< Games stopped after reaching the ply limit. */
+	int threads = 0;
+	double seconds = 0;
+
+	size_t whiteWins = 0;
+	size_t blackWins = 0;
+	size_t draws = 0;
+	std::array<size_t, endCount> ends = {};		/**< Games per GameEnd. */
+
+	double gamesPerSecond() const {
+		return seconds > 0 ? games / seconds : 0;
+	}
+
+	double pliesPerSecond() const {
+		return seconds > 0 ? plies / seconds : 0;
+	}
+};
+
+/**
+	Play random games to completion on the given number of threads.
+
+	Every thread owns its board. Game i is always played with an mt19937
+	seeded with seed + i, whichever thread plays it, so the outcomes are
+	the same for any number of threads. Moves go through tryMove, so the
+	detection of mate, stalemate, repetition and the 50 move rule runs
+	exactly as in a real game. Promotions pick a random piece.
+
+	\param games Number of games to play.
+	\param threads Number of threads to play them on, at least 1.
+	\param seed Seed of the first game.
+	\param maxPlies Games that reach this many moves are stopped and
+			counted as unfinished.
+	\return Totals of all games.
+*/
+SelfPlayResult runSelfPlay(size_t games, int threads, uint32_t seed, size_t maxPlies = 1000);
+
+/**
+	Format the result into a human readable report.
+*/
+std::string formatSelfPlay(const SelfPlayResult& result);
+
+/**
+	Format the result as a JSON object.
+*/
+std::string selfPlayToJSON(const SelfPlayResult& result);
+
+#endif // SELF_PLAY_HEADER_H_
@@ -7,6 +7,16 @@
 #include "../boardtype.hpp"
 #include <memory>
 
-std::shared_ptr<GenericBoard> getBoard(BoardType type);
+/**
+	Create a new board of the given type.
+
+	Every call returns a new board, independent of all other boards, so any
+	number of games can be played at the same time. The board still has to
+	be initialized before it is played on.
+
+	\param type Type of the board.
+	\return The new board, nullptr for unknown types.
+*/
+std::shared_ptr<GenericBoard> newBoard(BoardType type);
 
 #endif // BOARD_BUILDER_HEADER_H_
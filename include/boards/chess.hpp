@@ -5,6 +5,8 @@
 
 #include "genericboard.hpp"
 
+#include <string_view>
+
 class ChessBoard : public GenericBoard {
 public:
 	ChessBoard() : GenericBoard(8, 8) { state.type = BoardType::Chess; }
@@ -15,6 +17,21 @@ public:
 	ChessBoard& operator=(ChessBoard&&) noexcept = default;
 
 	void initialize() override;
+	std::shared_ptr<GenericBoard> clone() const override;
+
+	/**
+		Set up the board from a position in Forsyth-Edwards Notation.
+
+		Castling rights, the en passant square and the halfmove clock are
+		honored. The fullmove number is accepted but ignored, as the board
+		always starts counting from the first turn.
+
+		\param fen Position to load, for example
+				"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1".
+		\return False if the position could not be parsed, the board is left
+				in the standard starting position in that case.
+	*/
+	bool loadFEN(std::string_view fen);
 };
 
 #endif // CHESS_BOARD_HEADER_H_
@@ -21,6 +21,18 @@
 
 class PieceGeneric;
 
+/**
+	Describes how a game ended.
+*/
+enum class GameEnd {
+	None,			/**< The game is still being played. */
+	Checkmate,
+	Stalemate,
+	FiftyMoves,		/**< 50 moves of both players without a capture or a pawn move. */
+	Repetition,		/**< The same position occured for the third time. */
+	Forfeit,
+};
+
 /**
 	A generic board that any specific game's boards can derive from.
 */
@@ -30,11 +42,16 @@ public:
 private:
 	Color winner = Color::None;
 	Color currentPlayer = Color::White;
+	GameEnd gameEnd = GameEnd::None;
 	
 	int turnNumber = 1;
 	int moveNumber = 1;
 
-	int lastProgress = 1;
+	/*
+		Number of the last move that captured or moved a pawn, 0 if none did.
+		Negative for a position loaded with moves since the last progress.
+	*/
+	int lastProgress = 0;
 
 	std::vector<std::pair<std::string, std::string>> turnStrings;
 
@@ -48,14 +65,23 @@ private:
 	void _removePieceFromVector(Color ofColor, Position pos);
 	void _addPieceToVector(Color ofColor, Position pos);
 
-	bool _canDoMove(Position fromPos, Position toPos);
+	bool _canDoMove(Position fromPos, Position toPos) const;
 	void _performMove(Position fromPos, Position toPos);
-	bool _canDoMove(BoardState& state, Position fromPos, Position toPos);
+	bool _canDoMove(const BoardState& state, BoardState& scratch, Position fromPos, Position toPos) const;
 	void _performMove(BoardState& state, Position fromPos, Position toPos);
 
 	void _switchColor();
 	void _checkStaleOrCheckmate();
+	void _rebuildPieceVectors();
 protected:
+	void _setPlayingColor(Color color);
+
+	/*
+		Set the moves since the last capture or pawn move, of a board that
+		was just initialized.
+	*/
+	void _setHalfmoveClock(int halfmove);
+
 	bool withinBounds(Position pos, int width, int height) const;
 	void _clearThreat();
 	void _clearThreat(BoardState& state) const;
@@ -71,11 +97,11 @@ protected:
 
 	virtual bool _checkRepetition();
 
-	virtual bool _checkStalemate();
-	virtual bool _checkStalemate(Color forColor);
+	virtual bool _checkStalemate() const;
+	virtual bool _checkStalemate(Color forColor) const;
 
-	virtual bool _checkCheckmate();
-	virtual bool _checkCheckmate(Color forColor);
+	virtual bool _checkCheckmate() const;
+	virtual bool _checkCheckmate(Color forColor) const;
 
 	virtual std::string parseTurnToString(Position from, PieceType fromType,
 										  Color fromColor, Position to,
@@ -145,7 +171,7 @@ protected:
 	Position selected = { -1, -1 };
 
 	bool _continualCheckCalc(Color checking) const;
-	bool _continualCheckCalc(BoardState& state, Color checking) const;
+	bool _continualCheckCalc(const BoardState& state, Color checking) const;
 public:
 	GenericBoard(int boardWidth, int boardHeight, int upgradeRows = 1);
 	virtual ~GenericBoard() = default;
@@ -162,8 +188,8 @@ public:
 	Position getKingPos(const BoardState& state) const;
 	Position getKingPos(const BoardState& state, Color color) const;
 
-	int getAvailableMoveCount();
-	int getAvailableMoveCount(Color color);
+	int getAvailableMoveCount() const;
+	int getAvailableMoveCount(Color color) const;
 
 	void addPiece(Position position, PieceType type, Color color);
 	virtual void addPiece(const char* strPos, PieceType type, Color color);
@@ -259,21 +285,97 @@ public:
 		return tryMove(selected, toPos, onUpgrade);
 	}
 
-	std::vector<Position> getPossibleMoves();
-	std::vector<Position> getPossibleMoves(Position pieceAtPos);
-	std::vector<Position> getPossibleMoves(const BoardState& state);
-	std::vector<Position> getPossibleMoves(const BoardState& state, Position pieceAtPos);
+	/*
+		The queries below never change the board, moves are tried on a copy
+		owned by the calling thread. Any number of threads may call them at once,
+		as long as no thread changes the board meanwhile.
+	*/
+
+	std::vector<Position> getPossibleMoves() const;
+	std::vector<Position> getPossibleMoves(Position pieceAtPos) const;
+	std::vector<Position> getPossibleMoves(const BoardState& state) const;
+	std::vector<Position> getPossibleMoves(const BoardState& state, Position pieceAtPos) const;
+
+	/**
+		Get all legal moves of a player.
+
+		\param forColor Color of the player, whether it is their turn or not.
+		\return Pairs of positions to move from and to, in order of the pieces
+				of the player.
+	*/
+	std::vector<std::pair<Position, Position>> getAllPossibleMoves(Color forColor) const;
+
+	/**
+		Test whether a piece can legally move, whether it is its turn or not.
+
+		\param fromPos Position of the piece.
+		\param toPos Position to move into.
+		\return True if the piece can move there without leaving its king in check.
+	*/
+	bool isLegalMove(Position fromPos, Position toPos) const;
+
+	/**
+		Test whether the king of a player is in check.
+	*/
+	bool isChecked(Color color) const;
+
+	/**
+		Get positions of all pieces of a player that attack a square.
+
+		\param atPos Attacked square.
+		\param byColor Color of the attacking player.
+		\return Positions of the attackers, empty if the square is outside of the board.
+	*/
+	std::vector<Position> getAttackers(Position atPos, Color byColor) const;
+
+	/**
+		Work out what moving a piece onto a square wins once all captures
+		on the square that pay off for either player are played, cheapest
+		attacker first. Attackers come from the threats of the square,
+		pieces lined up behind them are added as they are uncovered.
+
+		\param fromPos Position of the moved piece.
+		\param toPos Position the piece moves onto, usually a capture.
+		\return Material won in centipawns by the owner of the moved piece,
+				negative if it loses material, 0 if there is no piece to move.
+	*/
+	int staticExchange(Position fromPos, Position toPos) const;
 
 	Color getWinner() const;
+	GameEnd getGameEnd() const;
 
 	void forfeit();
 
 	int getTurn() const;
 
+	/**
+		Get the number of moves of either player since the last capture
+		or pawn move, the 50 move rule ends the game at 100.
+	*/
+	int getHalfmoveClock() const;
+
 	std::pair<std::string, std::string> getTurnInfo() const;
 	std::pair<std::string, std::string> getTurnInfo(int turn) const;
 
 	std::vector<std::pair<std::string, std::string>> getTurnInfo(int turn, int until) const;
+
+	/**
+		Estimate the memory held by this board, the board object itself
+		included.
+
+		Pieces are shared between boards and are not counted. The estimate
+		grows as the game goes on, with the recorded moves and positions.
+
+		\return Approximate number of bytes.
+	*/
+	virtual size_t memoryUsage() const;
+
+	/**
+		Create an independent copy of this board, of the same type.
+
+		The copy can be read by other threads while this board goes on.
+	*/
+	virtual std::shared_ptr<GenericBoard> clone() const;
 };
 
 #endif // GENERIC_BOARD_HEADER_H_
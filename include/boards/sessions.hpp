@@ -0,0 +1,162 @@
+#pragma once
+
+#ifndef SESSIONS_HEADER_H_
+#define SESSIONS_HEADER_H_
+
+/*
+	This file contains:
+		- Definition of GameSession, a single game hosted by a SessionManager.
+		- Definition of SessionManager, which hosts many independent games
+		  at the same time and can be used from many threads.
+*/
+
+#include "genericboard.hpp"
+#include "../boardtype.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using session_id_t = uint64_t;
+
+/**
+	A single game hosted by a SessionManager.
+
+	The board may only be used while holding the lock, SessionManager::with
+	does that for you. Readers that only query the game should use
+	SessionManager::view instead.
+*/
+struct GameSession {
+	session_id_t id = 0;
+	std::shared_ptr<GenericBoard> board;
+	std::mutex lock;
+
+	std::shared_ptr<const GenericBoard> published;	/**< Copy of the board handed to readers, guarded by lock. */
+	bool changed = true;							/**< The board changed since it was published, guarded by lock. */
+};
+
+/**
+	Hosts independent games, each with its own board, under unique ids.
+
+	Sessions are spread over shards by their id, every shard with its own
+	lock, so threads working on different games rarely wait on each other.
+	Every game is locked separately while it is being played.
+*/
+class SessionManager {
+	static constexpr size_t shardCount = 64;
+
+	struct alignas(64) Shard {
+		mutable std::mutex lock;
+		std::unordered_map<session_id_t, std::shared_ptr<GameSession>> sessions;
+	};
+
+	std::array<Shard, shardCount> shards;
+	std::atomic<session_id_t> nextId = 1;
+	std::atomic<size_t> count = 0;
+	size_t limit;
+
+	Shard& _shard(session_id_t id) {
+		return shards[id % shardCount];
+	}
+
+	const Shard& _shard(session_id_t id) const {
+		return shards[id % shardCount];
+	}
+public:
+	/**
+		\param maxSessions Most sessions open at the same time, 0 for no limit.
+	*/
+	explicit SessionManager(size_t maxSessions = 0) : limit(maxSessions) {}
+	SessionManager(const SessionManager&) = delete;
+	SessionManager& operator=(const SessionManager&) = delete;
+
+	/**
+		Open a new game on a new initialized board.
+
+		\param type Type of the board to play on.
+		\return Id of the new session, 0 if the type is unknown or too many
+				sessions are open.
+	*/
+	session_id_t create(BoardType type);
+
+	/**
+		Find an open session.
+
+		The session stays valid for as long as the pointer is held,
+		even if it is closed meanwhile.
+
+		\return The session, nullptr if no session with this id is open.
+	*/
+	std::shared_ptr<GameSession> find(session_id_t id) const;
+
+	/**
+		Close a session.
+
+		\return False if no session with this id was open.
+	*/
+	bool close(session_id_t id);
+
+	/**
+		Call func with the board of a session, while holding its lock.
+
+		\param id Id of the session.
+		\param func Function of signature void(GenericBoard&).
+		\return False if no session with this id is open, func is not called then.
+	*/
+	template <class Func>
+	bool with(session_id_t id, Func&& func) {
+		auto session = find(id);
+		if (!session)	return false;
+
+		std::lock_guard guard{ session->lock };
+		session->changed = true;
+		func(*session->board);
+		return true;
+	}
+
+	/**
+		Get a read-only copy of the board of a session.
+
+		The copy never changes, so any number of threads can run the const
+		queries of GenericBoard on it at once without any lock. Only the first
+		call after the game changed copies the board, later calls share the copy.
+
+		\return The copy, nullptr if no session with this id is open.
+	*/
+	std::shared_ptr<const GenericBoard> view(session_id_t id) const;
+
+	/**
+		Get ids of all open sessions.
+	*/
+	std::vector<session_id_t> ids() const;
+
+	/**
+		Get number of open sessions.
+	*/
+	size_t size() const {
+		return count.load(std::memory_order_relaxed);
+	}
+
+	/**
+		Estimate memory held by all open sessions, the boards and
+		the bookkeeping of the manager included.
+
+		Locks every session in turn, so it waits for the games being played.
+
+		\return Approximate number of bytes.
+	*/
+	size_t memoryUsage() const;
+
+	/**
+		Estimate memory the manager needs for every session besides its board.
+
+		\return Approximate number of bytes.
+	*/
+	static size_t sessionOverhead();
+};
+
+#endif // SESSIONS_HEADER_H_
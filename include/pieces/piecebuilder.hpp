@@ -8,6 +8,17 @@
 
 #include <memory>
 
+/**
+	Get a piece of the given type and color.
+
+	Pieces hold nothing but their color, so every call with the same type
+	and color on the same thread returns the same shared instance, and boards
+	cost no allocations per piece.
+
+	\param type Type of the piece.
+	\param c Color of the piece.
+	\return Shared piece, nullptr for unknown types.
+*/
 std::shared_ptr<PieceGeneric> newPieceByType(PieceType type, Color c = Color::None);
 
 #endif // PIECE_BUILDER_HEADER_H_
@@ -2,6 +2,7 @@
 #ifndef PIECE_TYPE_HEADER_H_
 #define PIECE_TYPE_HEADER_H_
 
+#include <algorithm>
 #include <cstdint>
 
 /**
@@ -18,4 +19,35 @@ enum class PieceType : uint8_t {
 	None,			/**< Empty field */
 };
 
+/**
+	Get the usual value of a piece in centipawns.
+	Kings, shadow pawns and empty fields are worth nothing.
+*/
+inline constexpr int pieceValue(PieceType type) {
+	switch (type) {
+	case PieceType::Pawn:	return 100;
+	case PieceType::Knight:	return 320;
+	case PieceType::Bishop:	return 330;
+	case PieceType::Rook:	return 500;
+	case PieceType::Queen:	return 900;
+	default:				return 0;
+	}
+}
+
+/**
+	Resolve the swap list of a static exchange evaluation, where either
+	player stops capturing once it no longer pays off.
+
+	\param gain gain[n] is what the player making the n-th capture wins,
+				if it is the last one. It is overwritten.
+	\param last Index of the last capture of the list.
+	\return What the first capture wins.
+*/
+inline int resolveExchange(int* gain, int last) {
+	for (; last > 0; --last)
+		gain[last - 1] = -std::max(-gain[last - 1], gain[last]);
+
+	return gain[0];
+}
+
 #endif	//PIECE_TYPE_HEADER_H_
\ No newline at end of file
@@ -7,6 +7,13 @@
 #include "stringutil.hpp"
 #include <vector>
 #include <utility>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include <chrono>
 
@@ -34,23 +41,263 @@
 #define EVALUATOR(x,y)  PASTER(x,y)
 #define NAME(fun) EVALUATOR(fun, __COUNTER__)
 
-#define ProfileDeclare Profiler NAME(_) (__func__, CURRENT_FUNCTION, __FILE__, std::to_string(__LINE__ - 1));
+#define PROFILE_DECLARE_IMPL(counter) \
+	static ProfileSite EVALUATOR(_site, counter) (__func__, CURRENT_FUNCTION, __FILE__, __LINE__ - 1); \
+	Profiler EVALUATOR(_, counter) (EVALUATOR(_site, counter));
+
+#define ProfileDeclare PROFILE_DECLARE_IMPL(__COUNTER__)
 
 namespace chrono = std::chrono;
 using timepoint_t = chrono::high_resolution_clock::duration;
 
+/**
+	Events counted by HardwareCounters, used as indices into counters_t.
+*/
+enum class HardwareEvent {
+	Cycles,
+	Instructions,
+	CacheMisses,
+	BranchMisses,
+
+	Count
+};
+
+using counters_t = std::array<uint64_t, static_cast<size_t>(HardwareEvent::Count)>;
+
+/**
+	Describes a single place in the code that declared ProfileDeclare.
+
+	Every call site owns exactly one instance of this as a function-local static,
+	so nothing describing the site has to be built on every call. All strings
+	are literals provided by the compiler, so sites stay valid even while
+	the program is exiting.
+
+	Whether the site is recorded at all is decided ahead of time, whenever
+	profiling is turned on or off or its filters change, so a disabled site
+	only costs a single check of enabled.
+*/
+struct ProfileSite {
+	const char* funcName;
+	const char* richFuncName;
+	const char* file;
+	int line;
+	size_t id;		/**< Index of this site, used to address its statistics. */
+	std::atomic<bool> enabled = false;
+
+	ProfileSite(const char* _fn, const char* _rfn, const char* _f, int _l);
+
+	/**
+		Get the name of the file without the path leading to it.
+	*/
+	std::string fileName() const;
+};
+
 struct StackFrame {
-	std::string funcName;
-	std::string richFuncName;
-	std::string file;
-	std::string line;
+	const ProfileSite* site;
 	timepoint_t callTime;
+	uint32_t node;		/**< Index into ThreadProfile::paths, only used by the folded mode. */
+	counters_t counts = {};		/**< Hardware counters at the time of the call, if enabled. */
+
+	StackFrame(const ProfileSite* _s, timepoint_t _t, uint32_t _n = 0) : site(_s), callTime(std::move(_t)), node(_n) {
+	}
+};
+
+/**
+	Defines what the Profiler does with the timings it collects.
+*/
+enum class ProfileMode {
+	Text,			/**< One formatted line per call, written into the target file. */
+	Aggregate,		/**< Per call site statistics kept in memory, written as one table. */
+	Trace,			/**< Chrome trace-event JSON, one complete event per call. */
+	Binary,			/**< Raw events, written by a background thread, decoded offline. */
+	Folded,			/**< Time per unique call path, written as folded stacks for flame graphs. */
+};
+
+/**
+	Aggregated timing statistics of a single call site.
+
+	Besides count, total, min and max, keeps a histogram with logarithmic buckets,
+	every power of two is split into subBuckets linear buckets. Percentiles
+	computed from it are therefore accurate to roughly 1 / subBuckets.
+*/
+struct SiteStats {
+	static constexpr int subBuckets = 4;
+	static constexpr int bucketCount = 64 * subBuckets;
+
+	uint64_t count = 0;
+	long long total = 0;
+	long long min = LLONG_MAX;
+	long long max = 0;
+	std::array<uint32_t, bucketCount> histogram = {};
+	counters_t hardware = {};		/**< Hardware events counted inside of the site, summed. */
+
+	/**
+		Record a single call that took given amount of nanoseconds.
+	*/
+	void add(long long ns);
+
+	/**
+		Approximate the given percentile from the histogram.
+
+		\param p Requested percentile, in range [0, 1].
+		\return Approximate duration in nanoseconds.
+	*/
+	long long percentile(double p) const;
+
+	/**
+		Add statistics collected elsewhere, for example on another thread.
+	*/
+	void merge(const SiteStats& other);
+};
+
+/**
+	A single call path in the tree kept by the folded mode. The path is made of
+	the site and all of its parents, up to the root at index 0.
+*/
+struct PathNode {
+	const ProfileSite* site;
+	uint32_t parent;
+	long long inclusive = 0;	/**< Nanoseconds spent in calls along this path. */
+	long long children = 0;		/**< Part of inclusive spent in paths going deeper. */
+
+	PathNode(const ProfileSite* _s, uint32_t _p) : site(_s), parent(_p) {
+	}
+};
+
+/**
+	A single finished scope, as recorded by the binary mode.
+*/
+struct ProfileEvent {
+	uint32_t siteId;	/**< ProfileSite::id of the scope. */
+	uint32_t threadId;	/**< Profiler::threadId of the thread that ran it. */
+	int64_t start;		/**< Nanoseconds since profiling was turned on. */
+	int64_t duration;	/**< Nanoseconds spent inside of the scope. */
+};
+
+/**
+	Fixed-size single producer, single consumer ring of events.
+
+	The thread owning it pushes, the background writer drains. When the ring
+	is full, new events are counted as dropped instead of waiting for the writer,
+	so the measured thread never blocks.
+*/
+class EventRing {
+	static constexpr uint64_t capacity = 1 << 16;
+
+	std::unique_ptr<ProfileEvent[]> events = std::make_unique<ProfileEvent[]>(capacity);
+	std::atomic<uint64_t> head = 0;		/**< Next slot written by the producer. */
+	std::atomic<uint64_t> tail = 0;		/**< Next slot read by the consumer. */
+	std::atomic<uint64_t> lost = 0;
+public:
+	/**
+		Push an event, only ever called by the owning thread.
+
+		\return False if the ring was full and the event got dropped.
+	*/
+	bool push(const ProfileEvent& event);
+
+	/**
+		Move all pushed events to the end of the vector, only ever called
+		by the writer.
+
+		\return Number of events moved.
+	*/
+	size_t drain(std::vector<ProfileEvent>& into);
+
+	uint64_t dropped() const {
+		return lost.load(std::memory_order_relaxed);
+	}
+};
+
+/**
+	Tags of records inside of a binary profile file.
+
+	A file starts with profileMagic, followed by any number of records.
+	Every record starts with its tag:
+		- Site: uint32 id, int32 line, then three strings, function,
+		  rich function and file, each as uint16 length and characters.
+		- Events: uint32 count, then count ProfileEvent structures.
+		- Dropped: uint64 total number of events dropped, last in the file.
+
+	All values are stored in the byte order of the machine that wrote them.
+*/
+enum class ProfileRecord : uint8_t {
+	Site = 'S',
+	Events = 'E',
+	Dropped = 'D',
+};
 
-	StackFrame(std::string _fn, std::string _rfn, std::string _f,
-			   std::string _l, timepoint_t _t) : funcName(std::move(_fn)), richFuncName(std::move(_rfn)),
-												file(std::move(_f)), line(std::move(_l)),
-												callTime(std::move(_t)) {
+constexpr char profileMagic[8] = "CHPROF1";
+
+/**
+	Hardware performance counters of a single thread, counting only while
+	the thread runs in user space.
+
+	Only available on Linux through perf_event_open. Elsewhere, or when
+	the kernel refuses some of the events, those events read as zero.
+*/
+class HardwareCounters {
+	int leader = -1;
+	counters_t::size_type opened = 0;
+	std::array<int, static_cast<size_t>(HardwareEvent::Count)> fds;
+	std::array<int, static_cast<size_t>(HardwareEvent::Count)> slots;	/**< Position in a group read, -1 if not counted. */
+public:
+	HardwareCounters();
+	~HardwareCounters();
+
+	HardwareCounters(const HardwareCounters&) = delete;
+	HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+	/**
+		Start counting on the calling thread.
+
+		\return True if at least one of the events is counted.
+	*/
+	bool open();
+
+	/**
+		Stop counting and release the counters, they read as zero afterwards.
+	*/
+	void close();
+
+	bool available() const {
+		return opened > 0;
 	}
+
+	/**
+		Read current values of all counters with a single system call.
+	*/
+	void read(counters_t& values) const;
+};
+
+/**
+	Everything the Profiler collects on a single thread.
+
+	Only the owning thread ever touches its callstack. The buffer and stats
+	are guarded by lock, which is only contended while they are being merged
+	into the target file by another thread. Call paths are guarded by the lock
+	too and are never removed, since frames on the callstack refer to them.
+	The binary mode bypasses the lock and goes through the ring instead,
+	which is allocated on first use and handed to the writer once the
+	thread exits.
+*/
+struct ThreadProfile {
+	int id;
+	std::vector<StackFrame> callstack;
+	std::string buffer;
+	std::vector<SiteStats> stats;
+	std::vector<uint32_t> entries;			/**< Scope entries per site, used for sampling. */
+	std::vector<PathNode> paths;
+	std::unordered_map<uint64_t, uint32_t> pathIndex;	/**< Parent node and site id to child node. */
+	std::atomic<long long> totalSpent = 0;	/**< Nanoseconds spent in the Profiler. */
+	std::atomic<EventRing*> ring = nullptr;
+	HardwareCounters hardware;			/**< Opened on first use by the owning thread. */
+	bool hardwareTried = false;
+	uint32_t sampledOut = 0;			/**< Open folded scopes inside one skipped by sampling. */
+	std::mutex lock;
+
+	explicit ThreadProfile(int _id);
+	~ThreadProfile();
 };
 
 class Profiler {
@@ -58,50 +305,196 @@ public:
 	using callstack_t = std::vector<StackFrame>;
 private:
 	static std::string targetFile;
-	static callstack_t callstack;
-	static int _verbosity;
-	static int _traceback;
-	static std::string buffer;
+	static std::atomic<bool> active;
+	static std::atomic<int> _verbosity;
+	static std::atomic<int> _traceback;
+	static std::atomic<ProfileMode> _mode;
+	static std::atomic<timepoint_t> traceStart;
+	static std::atomic<int> _sampling;
+	static std::atomic<bool> _counters;
+
+	bool recorded;		/**< False when the site was disabled or skipped by sampling. */
+	bool sampledOut = false;	/**< Counted in ThreadProfile::sampledOut. */
 
+	friend struct ProfileSite;
 	friend void dumpBuffer(bool exiting);
-	friend void partialDump();
+	friend std::string formatEvent(const StackFrame& frame, const timepoint_t& now);
+
+	/**
+		Get the profile of the calling thread, creating and registering it
+		on first use.
+	*/
+	static ThreadProfile& local();
+
+	/**
+		Get profiles of all running threads that entered a profiled scope.
+		The first one belongs to no thread, it holds what exited threads
+		collected, so nothing gets lost when they are dropped.
+	*/
+	static std::vector<std::shared_ptr<ThreadProfile>>& threads();
+
+	/**
+		Hand over what a thread still holds, called once it exits.
 
-	static timepoint_t totalSpent;
+		\return True if the profile was merged into the first one and dropped.
+	*/
+	static bool _threadExited(ThreadProfile& profile);
+
+	/**
+		Recompute ProfileSite::enabled of every site after the target or
+		the filters changed.
+	*/
+	static void _refreshSites();
+
+	/**
+		Find or create the node of the call path that enters the site from
+		the top of the callstack of the thread.
+	*/
+	static uint32_t _enterPath(ThreadProfile& profile, const ProfileSite& site);
 public:
-	Profiler(std::string func, std::string prettyFunc, std::string file, std::string line);
+	Profiler(const ProfileSite& site);
 	~Profiler();
 
+	/**
+		Get all call sites that were reached so far.
+
+		\return Call sites, indexed by ProfileSite::id.
+	*/
+	static std::vector<const ProfileSite*>& sites();
+
 	static std::string& target() {
 		return targetFile;
 	}
 
 	static void target(std::string targetFil);
 
+	/**
+		Switch the target file and the mode of profiling together, so a binary
+		trace is only started once, on the new file. Clears all statistics
+		collected so far.
+	*/
+	static void target(std::string targetFil, ProfileMode newMode);
+
 	static int verbosity() {
-		return _verbosity;
+		return _verbosity.load(std::memory_order_relaxed);
 	}
 
 	static void verbosity(int newV) {
 		_verbosity = newV;
 	}
 
-	static timepoint_t spent() {
-		return totalSpent;
-	}
+	/**
+		Get time spent inside the Profiler itself, summed over all threads.
+	*/
+	static timepoint_t spent();
+
+	/**
+		Get a small sequential identifier of the calling thread, the first thread
+		that asks receives 1.
+	*/
+	static int threadId();
 
 	static int traceback() {
-		return _traceback;
+		return _traceback.load(std::memory_order_relaxed);
 	}
 
 	static void traceback(int newV) {
 		_traceback = newV;
 	}
 
+	/**
+		Get the callstack of the calling thread.
+	*/
 	static const callstack_t& stack() {
-		return callstack;
+		return local().callstack;
+	}
+
+	static ProfileMode mode() {
+		return _mode.load(std::memory_order_relaxed);
+	}
+
+	/**
+		Switch the mode of profiling. Clears all statistics collected so far.
+	*/
+	static void mode(ProfileMode newMode);
+
+	static int sampling() {
+		return _sampling.load(std::memory_order_relaxed);
+	}
+
+	/**
+		Record only every Nth entry of every call site, counted per thread.
+		Calls that are skipped do not appear in tracebacks either. In the
+		folded mode, everything called from a skipped call is skipped too,
+		so every folded stack is one that really happened.
+
+		\param everyNth How many entries make one recorded call, 1 records all.
+	*/
+	static void sampling(int everyNth);
+
+	/**
+		Only record sites whose function name, signature or file contains
+		the pattern. When called repeatedly, sites matching any of the patterns
+		are recorded.
+	*/
+	static void include(std::string pattern);
+
+	/**
+		Never record sites whose function name, signature or file contains
+		the pattern. Exclusions take precedence over inclusions.
+	*/
+	static void exclude(std::string pattern);
+
+	/**
+		Remove all inclusions and exclusions, recording every site again.
+	*/
+	static void clearFilters();
+
+	static bool counters() {
+		return _counters.load(std::memory_order_relaxed);
 	}
+
+	/**
+		Also collect hardware counters per call site in aggregate mode.
+		Where the counters are not available, only timings are collected.
+	*/
+	static void counters(bool enabled) {
+		_counters = enabled;
+	}
+
+	/**
+		Format the statistics collected in aggregate mode into a table,
+		one row per call site, sorted by total time spent in it.
+		Statistics of all threads are merged together.
+
+		\return Formatted table, empty if no statistics were collected.
+	*/
+	static std::string summary();
+
+	/**
+		Format the call paths collected in folded mode, one line per path
+		in the form "a;b;c 1234", where the number is the time in nanoseconds
+		spent in c itself when called through a and b. Tools such as
+		flamegraph.pl sum the lines back into inclusive time of every path.
+		Paths of all threads are merged together.
+	*/
+	static std::string folded();
+
+	/**
+		Write everything collected so far by all threads into the target
+		file, without finishing it. Aggregate and folded modes rewrite
+		the whole file.
+	*/
+	static void flush();
 };
 
 void dumpBuffer(bool exiting);
 
+/**
+	Format a duration into a human readable form, such as 12.5ms.
+
+	\param counter Duration in nanoseconds.
+*/
+std::string formatDuration(long long counter);
+
 #endif // PROFILER_HEADER_H_
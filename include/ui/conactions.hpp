@@ -137,6 +137,9 @@ namespace actions {
 	bool forfeit(		GenericBoard& board, const std::vector<std::string_view>& args);
 	bool move(			GenericBoard& board, const std::vector<std::string_view>& args);
 	bool profile(		GenericBoard& board, const std::vector<std::string_view>& args);
+	bool go(			GenericBoard& board, const std::vector<std::string_view>& args);
+	bool nnue(			GenericBoard& board, const std::vector<std::string_view>& args);
+	bool mcts(			GenericBoard& board, const std::vector<std::string_view>& args);
 }
 
 
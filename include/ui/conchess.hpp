@@ -16,7 +16,7 @@
 using namespace std::string_literals;
 
 class ConsoleChess {
-	std::shared_ptr<GenericBoard> board = ::getBoard(BoardType::Chess);
+	std::shared_ptr<GenericBoard> board = ::newBoard(BoardType::Chess);
 	int gridSize = 2;
 	std::pair<int, int> turns = { 1, 1 };
 protected:
@@ -30,6 +30,9 @@ enum class Command {
 	Render,
 	Profile,
 	Export,
+	Go,
+	Nnue,
+	Mcts,
 
 	Invalid
 };
@@ -101,16 +104,69 @@ inline std::unordered_map<Command, std::pair<std::string, std::string>> commandH
 	},
 	{ Command::Profile, std::make_pair("profile off\nprofile [on] file\n"s
 									   "profile [on] file verbose\nprofile [on] file traceback\n"s
-									   "profile [on] file total"s,
+									   "profile [on] file total\nprofile [on] file stats\n"s
+									   "profile [on] file counters\n"s
+									   "profile [on] file trace\nprofile [on] file binary\n"s
+									   "profile [on] file folded\n"s
+									   "profile dump\nprofile sample N\n"s
+									   "profile only NAME\nprofile skip NAME\nprofile all"s,
 			"Turns profiling of the program on or off.\n"s
 			"Profiling puts the execution time of every"s "\n"s
 			"function into a file.\n"s
 			"If verbose is provided, will also include stack trace.\n"s
-			"Note that total profiling uses a lot of disk space.")
+			"Note that total profiling uses a lot of disk space.\n"s
+			"If stats is provided, only keeps call count, total,\n"s
+			"min, max, p50 and p99 per function and writes them\n"s
+			"as one table sorted by total time on exit.\n"s
+			"counters works like stats, but on Linux also adds\n"s
+			"IPC, cache misses and branch misses per function.\n"s
+			"If trace is provided, writes Chrome trace-event JSON\n"s
+			"that can be opened in Perfetto or chrome://tracing.\n"s
+			"If binary is provided, a background thread writes raw\n"s
+			"events, which profdecode turns into text afterwards.\n"s
+			"If folded is provided, writes time per call path as\n"s
+			"folded stacks, ready to be drawn by flamegraph.pl.\n"s
+			"profile dump writes what was collected so far.\n"s
+			"profile sample N records only every Nth call of\n"s
+			"every function, 1 records all of them. Folded stacks\n"s
+			"skip all calls made by a call that was skipped.\n"s
+			"profile only NAME records only functions whose name\n"s
+			"or file contains NAME, profile skip NAME never records\n"s
+			"them and profile all removes both filters.")
 	},
 	{ Command::Export, std::make_pair("export FILE"s,
 			"Exports the list of moves made up until this point into\n"s
 			"a file."s)
+	},
+	{ Command::Go, std::make_pair("go\ngo [depth N] [nodes N] [time MS] [threads N] [multipv N]\n"s
+			"go clock MS [inc MS] [movestogo N]"s,
+			"Lets the engine search for the best move of the player\n"s
+			"that is currently playing and plays it.\n"s
+			"Prints the best line after every finished depth.\n"s
+			"Without limits searches for 3 seconds, otherwise stops\n"s
+			"at depth N, after N nodes or after MS milliseconds,\n"s
+			"whichever comes first. Searches on all cores, unless\n"s
+			"threads N sets the number of threads. With multipv N,\n"s
+			"also prints the best lines of the N - 1 runner-up moves.\n"s
+			"With clock, the player has MS milliseconds left, gains\n"s
+			"inc after every move and has to make movestogo moves\n"s
+			"before the next time control, the engine decides how\n"s
+			"much of it to spend on this move."s)
+	},
+	{ Command::Nnue, std::make_pair("nnue FILE\nnnue off"s,
+			"Loads a network from FILE, the engine evaluates\n"s
+			"positions with it from the next go on.\n"s
+			"With off, goes back to the hand-written evaluation."s)
+	},
+	{ Command::Mcts, std::make_pair("mcts\nmcts [playouts N] [time MS] [threads N] [rollout random]"s,
+			"Lets the engine search for the best move of the player\n"s
+			"that is currently playing with Monte Carlo tree search\n"s
+			"and plays it. Prints the most visited moves.\n"s
+			"Without limits searches for 3 seconds, otherwise stops\n"s
+			"after N playouts or after MS milliseconds, whichever\n"s
+			"comes first. Searches on all cores sharing one tree,\n"s
+			"or on N threads if given. Playouts prefer captures that\n"s
+			"do not lose material, unless rollout random is given."s)
 	}
 };
 
@@ -131,7 +187,10 @@ inline auto cmdToIdx = [](std::string_view input) {
 		{ "grid", Command::Grid },
 		{ "render", Command::Render },
 		{ "profile", Command::Profile },
-		{ "export", Command::Export }
+		{ "export", Command::Export },
+		{ "go", Command::Go },
+		{ "nnue", Command::Nnue },
+		{ "mcts", Command::Mcts }
 	};
 
 	if (map.find(input) == map.end())	return Command::Invalid;
@@ -156,6 +215,9 @@ inline std::unordered_map<Command, CommandHandler> commandHandlers = {
 	{ Command::Render,		actions::render },
 	{ Command::Profile,		actions::profile },
 	{ Command::Export,		actions::export_moves },
+	{ Command::Go,			actions::go },
+	{ Command::Nnue,		actions::nnue },
+	{ Command::Mcts,		actions::mcts },
 };
 
 #endif // CON_COMMAND_HEADER_H_
@@ -0,0 +1,407 @@
+#include "../../include/ai/evaluation.hpp"
+#include "../../include/ai/nnue.hpp"
+#include "../../include/ai/pawntable.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+
+/*
+	Piece-square tables, as the board looks from the side of white:
+	the first row is the eighth rank, the last one the first rank.
+	Black uses them mirrored.
+*/
+static constexpr int _pawnMiddlegame[64] = {
+	  0,   0,   0,   0,   0,   0,   0,   0,
+	 50,  50,  50,  50,  50,  50,  50,  50,
+	 10,  10,  20,  30,  30,  20,  10,  10,
+	  5,   5,  10,  25,  25,  10,   5,   5,
+	  0,   0,   0,  20,  20,   0,   0,   0,
+	  5,  -5, -10,   0,   0, -10,  -5,   5,
+	  5,  10,  10, -20, -20,  10,  10,   5,
+	  0,   0,   0,   0,   0,   0,   0,   0,
+};
+
+static constexpr int _pawnEndgame[64] = {
+	  0,   0,   0,   0,   0,   0,   0,   0,
+	 80,  80,  80,  80,  80,  80,  80,  80,
+	 50,  50,  50,  50,  50,  50,  50,  50,
+	 30,  30,  30,  30,  30,  30,  30,  30,
+	 15,  15,  15,  15,  15,  15,  15,  15,
+	  5,   5,   5,   5,   5,   5,   5,   5,
+	  0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,
+};
+
+static constexpr int _knight[64] = {
+	-50, -40, -30, -30, -30, -30, -40, -50,
+	-40, -20,   0,   0,   0,   0, -20, -40,
+	-30,   0,  10,  15,  15,  10,   0, -30,
+	-30,   5,  15,  20,  20,  15,   5, -30,
+	-30,   0,  15,  20,  20,  15,   0, -30,
+	-30,   5,  10,  15,  15,  10,   5, -30,
+	-40, -20,   0,   5,   5,   0, -20, -40,
+	-50, -40, -30, -30, -30, -30, -40, -50,
+};
+
+static constexpr int _bishop[64] = {
+	-20, -10, -10, -10, -10, -10, -10, -20,
+	-10,   0,   0,   0,   0,   0,   0, -10,
+	-10,   0,   5,  10,  10,   5,   0, -10,
+	-10,   5,   5,  10,  10,   5,   5, -10,
+	-10,   0,  10,  10,  10,  10,   0, -10,
+	-10,  10,  10,  10,  10,  10,  10, -10,
+	-10,   5,   0,   0,   0,   0,   5, -10,
+	-20, -10, -10, -10, -10, -10, -10, -20,
+};
+
+static constexpr int _rook[64] = {
+	  0,   0,   0,   0,   0,   0,   0,   0,
+	  5,  10,  10,  10,  10,  10,  10,   5,
+	 -5,   0,   0,   0,   0,   0,   0,  -5,
+	 -5,   0,   0,   0,   0,   0,   0,  -5,
+	 -5,   0,   0,   0,   0,   0,   0,  -5,
+	 -5,   0,   0,   0,   0,   0,   0,  -5,
+	 -5,   0,   0,   0,   0,   0,   0,  -5,
+	  0,   0,   0,   5,   5,   0,   0,   0,
+};
+
+static constexpr int _queen[64] = {
+	-20, -10, -10,  -5,  -5, -10, -10, -20,
+	-10,   0,   0,   0,   0,   0,   0, -10,
+	-10,   0,   5,   5,   5,   5,   0, -10,
+	 -5,   0,   5,   5,   5,   5,   0,  -5,
+	  0,   0,   5,   5,   5,   5,   0,  -5,
+	-10,   5,   5,   5,   5,   5,   0, -10,
+	-10,   0,   5,   0,   0,   0,   0, -10,
+	-20, -10, -10,  -5,  -5, -10, -10, -20,
+};
+
+static constexpr int _kingMiddlegame[64] = {
+	-30, -40, -40, -50, -50, -40, -40, -30,
+	-30, -40, -40, -50, -50, -40, -40, -30,
+	-30, -40, -40, -50, -50, -40, -40, -30,
+	-30, -40, -40, -50, -50, -40, -40, -30,
+	-20, -30, -30, -40, -40, -30, -30, -20,
+	-10, -20, -20, -20, -20, -20, -20, -10,
+	 20,  20,   0,   0,   0,   0,  20,  20,
+	 20,  30,  10,   0,   0,  10,  30,  20,
+};
+
+static constexpr int _kingEndgame[64] = {
+	-50, -40, -30, -20, -20, -30, -40, -50,
+	-30, -20, -10,   0,   0, -10, -20, -30,
+	-30, -10,  20,  30,  30,  20, -10, -30,
+	-30, -10,  30,  40,  40,  30, -10, -30,
+	-30, -10,  30,  40,  40,  30, -10, -30,
+	-30, -10,  20,  30,  30,  20, -10, -30,
+	-30, -30,   0,   0,   0,   0, -30, -30,
+	-50, -30, -30, -30, -30, -30, -30, -50,
+};
+
+/*
+	Material in the middlegame and in the endgame, indexed by PieceType.
+*/
+static constexpr TaperedScore _material[6] = {
+	{ 82, 94 }, { 337, 281 }, { 365, 297 }, { 477, 512 }, { 1025, 936 }, { 0, 0 }
+};
+
+static constexpr int _phaseWeights[6] = { 0, 1, 1, 2, 4, 0 };
+
+/*
+	Material and piece-square scores from the view of white, indexed by piece_t and square.
+*/
+static const std::array<std::array<TaperedScore, 64>, 16> _pieceSquare = [] {
+	const int* middlegame[6] = { _pawnMiddlegame, _knight, _bishop, _rook, _queen, _kingMiddlegame };
+	const int* endgame[6] = { _pawnEndgame, _knight, _bishop, _rook, _queen, _kingEndgame };
+
+	std::array<std::array<TaperedScore, 64>, 16> table = {};
+	for (int type = 0; type < 6; ++type) {
+		for (int square = 0; square < 64; ++square) {
+			int rank = square / 8;
+			int file = square % 8;
+
+			int whiteIdx = (7 - rank) * 8 + file;
+			auto& white = table[makePiece(static_cast<PieceType>(type), Color::White)][square];
+			white.middlegame = _material[type].middlegame + middlegame[type][whiteIdx];
+			white.endgame = _material[type].endgame + endgame[type][whiteIdx];
+
+			int blackIdx = rank * 8 + file;
+			auto& black = table[makePiece(static_cast<PieceType>(type), Color::Black)][square];
+			black.middlegame = -(_material[type].middlegame + middlegame[type][blackIdx]);
+			black.endgame = -(_material[type].endgame + endgame[type][blackIdx]);
+		}
+	}
+	return table;
+}();
+
+/*
+	Mobility per square a piece can move to, indexed by PieceType,
+	and how many squares it is expected to have anyway.
+*/
+static constexpr TaperedScore _mobility[6] = { {}, { 4, 4 }, { 5, 5 }, { 2, 4 }, { 1, 2 }, {} };
+static constexpr int _expectedMobility[6] = { 0, 4, 6, 7, 13, 0 };
+
+/*
+	Weight of an attack on the squares around the enemy king, indexed by PieceType.
+*/
+static constexpr int _kingAttackWeights[6] = { 0, 2, 2, 3, 5, 0 };
+
+static constexpr TaperedScore _doubledPawn = { -10, -20 };
+static constexpr TaperedScore _isolatedPawn = { -10, -15 };
+static constexpr TaperedScore _backwardPawn = { -8, -10 };
+static constexpr TaperedScore _bishopPair = { 30, 50 };
+
+/*
+	Bonus for a passed pawn, indexed by how far it has come, the start rank is 1.
+*/
+static constexpr TaperedScore _passedPawn[8] = {
+	{}, { 0, 5 }, { 5, 10 }, { 10, 20 }, { 20, 40 }, { 35, 70 }, { 60, 120 }, {}
+};
+
+static constexpr int _shieldPawn = 10;
+
+/*
+	The terms are rarely worth more than this, outside of the window
+	by more than this they are not worked out.
+*/
+static constexpr int _lazyMargin = 300;
+
+static constexpr int _knightSteps[8][2] = {
+	{ 1, 2 }, { 2, 1 }, { 2, -1 }, { 1, -2 }, { -1, -2 }, { -2, -1 }, { -2, 1 }, { -1, 2 }
+};
+
+static constexpr int _directions[8][2] = {
+	{ 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 }, { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }
+};
+
+inline bool _onBoard(int rank, int file) {
+	return rank >= 0 && rank < 8 && file >= 0 && file < 8;
+}
+
+inline uint64_t _bit(int square) {
+	return 1ull << square;
+}
+
+int TaperedScore::blend(int phase) const
+{
+	phase = std::clamp(phase, 0, maxPhase);
+	return (middlegame * phase + endgame * (maxPhase - phase)) / maxPhase;
+}
+
+int phaseWeight(PieceType type)
+{
+	return type < PieceType::ShadowPawn ? _phaseWeights[static_cast<int>(type)] : 0;
+}
+
+const TaperedScore& pieceSquareScore(piece_t piece, square_t square)
+{
+	return _pieceSquare[piece][square];
+}
+
+/*
+	Pawn structure of one player: doubled, isolated, backward and passed pawns.
+*/
+static TaperedScore _pawnStructure(const PawnEntry& entry, Color color)
+{
+	TaperedScore score;
+	auto own = entry.pawns[static_cast<int>(color)];
+	auto enemy = entry.pawns[static_cast<int>(opposite(color))];
+	auto enemyAttacks = entry.attacks[static_cast<int>(opposite(color))];
+
+	std::array<int, 8> files = {};
+	for (int square = 0; square < 64; ++square)
+		if (own & _bit(square))	++files[square % 8];
+
+	for (int file = 0; file < 8; ++file) {
+		if (files[file] > 1) {
+			score.middlegame += _doubledPawn.middlegame * (files[file] - 1);
+			score.endgame += _doubledPawn.endgame * (files[file] - 1);
+		}
+
+		bool neighbours = (file > 0 && files[file - 1]) || (file < 7 && files[file + 1]);
+		if (files[file] && !neighbours) {
+			score.middlegame += _isolatedPawn.middlegame * files[file];
+			score.endgame += _isolatedPawn.endgame * files[file];
+		}
+	}
+
+	int forward = color == Color::White ? 1 : -1;
+	for (int square = 0; square < 64; ++square) {
+		if (!(own & _bit(square)))	continue;
+
+		int rank = square / 8;
+		int file = square % 8;
+
+		//Passed if no enemy pawn stands ahead on its file or the files beside it
+		bool passed = true;
+		for (int r = rank + forward; passed && r >= 0 && r < 8; r += forward)
+			for (int f = std::max(file - 1, 0); f <= std::min(file + 1, 7); ++f)
+				if (enemy & _bit(r * 8 + f))	passed = false;
+
+		if (passed)
+			score += _passedPawn[color == Color::White ? rank : 7 - rank];
+
+		//Backward if its stop square is guarded by an enemy pawn and no pawn
+		//beside it is level or behind to support it, isolated pawns are counted already
+		bool neighbours = (file > 0 && files[file - 1]) || (file < 7 && files[file + 1]);
+		int stop = square + forward * 8;
+		if (neighbours && stop >= 0 && stop < 64 && (enemyAttacks & _bit(stop))) {
+			bool supported = false;
+			for (int r = rank; !supported && r >= 0 && r < 8; r -= forward)
+				for (int f : { file - 1, file + 1 })
+					if (f >= 0 && f < 8 && (own & _bit(r * 8 + f)))	supported = true;
+
+			if (!supported)
+				score += _backwardPawn;
+		}
+	}
+
+	return score;
+}
+
+/*
+	Fill in an entry of the pawn table from the pawns of a position.
+*/
+static void _evaluatePawns(const SearchPosition& position, PawnEntry& entry)
+{
+	entry.key = position.pawnHash();
+	entry.pawns = {};
+	entry.attacks = {};
+
+	for (square_t square = 0; square < 64; ++square) {
+		auto piece = position.at(square);
+		if (pieceType(piece) != PieceType::Pawn)	continue;
+
+		int color = static_cast<int>(pieceColor(piece));
+		int rank = square / 8 + (pieceColor(piece) == Color::White ? 1 : -1);
+		entry.pawns[color] |= _bit(square);
+		for (int file : { square % 8 - 1, square % 8 + 1 })
+			if (_onBoard(rank, file))	entry.attacks[color] |= _bit(rank * 8 + file);
+	}
+
+	entry.score = _pawnStructure(entry, Color::White);
+	entry.score -= _pawnStructure(entry, Color::Black);
+}
+
+/*
+	Mobility, king safety and pawn structure from the view of white.
+*/
+static TaperedScore _positionalTerms(const SearchPosition& position, PawnTable* pawnTable)
+{
+	PawnEntry local;
+	bool found = false;
+	auto& entry = pawnTable ? pawnTable->probe(position.pawnHash(), found) : local;
+	if (!found)
+		_evaluatePawns(position, entry);
+
+	auto& pawns = entry.pawns;
+	auto& pawnAttacks = entry.attacks;
+	std::array<uint64_t, 2> kingZones = {};
+	std::array<int, 2> bishops = {};
+
+	for (auto color : { Color::Black, Color::White }) {
+		auto king = position.kingSquare(color);
+		for (int rank = king / 8 - 1; rank <= king / 8 + 1; ++rank)
+			for (int file = king % 8 - 1; file <= king % 8 + 1; ++file)
+				if (_onBoard(rank, file))	kingZones[static_cast<int>(color)] |= _bit(rank * 8 + file);
+	}
+
+	std::array<TaperedScore, 2> scores;
+	scores[static_cast<int>(Color::White)] = entry.score;
+	std::array<int, 2> attackUnits = {};
+	std::array<int, 2> attackers = {};
+
+	for (square_t square = 0; square < 64; ++square) {
+		auto piece = position.at(square);
+		auto type = pieceType(piece);
+		if (type < PieceType::Knight || type > PieceType::Queen)	continue;
+
+		auto color = pieceColor(piece);
+		int own = static_cast<int>(color);
+		int enemy = static_cast<int>(opposite(color));
+		bishops[own] += type == PieceType::Bishop;
+
+		//Squares guarded by enemy pawns do not count, the piece could not stay there
+		int moves = 0;
+		bool attacksKing = false;
+		auto _visit = [&](int rank, int file) {
+			auto target = position.at(static_cast<square_t>(rank * 8 + file));
+			if (target && pieceColor(target) == color)	return;
+			if (!(pawnAttacks[enemy] & _bit(rank * 8 + file)))	++moves;
+			if (kingZones[enemy] & _bit(rank * 8 + file)) {
+				attackUnits[own] += _kingAttackWeights[static_cast<int>(type)];
+				attacksKing = true;
+			}
+		};
+
+		if (type == PieceType::Knight) {
+			for (auto& step : _knightSteps)
+				if (_onBoard(square / 8 + step[0], square % 8 + step[1]))
+					_visit(square / 8 + step[0], square % 8 + step[1]);
+		}
+		else {
+			int first = type == PieceType::Rook ? 4 : 0;
+			int last = type == PieceType::Bishop ? 4 : 8;
+			for (int dir = first; dir < last; ++dir) {
+				int rank = square / 8 + _directions[dir][0];
+				int file = square % 8 + _directions[dir][1];
+				for (; _onBoard(rank, file); rank += _directions[dir][0], file += _directions[dir][1]) {
+					_visit(rank, file);
+					if (position.at(static_cast<square_t>(rank * 8 + file)))	break;
+				}
+			}
+		}
+
+		attackers[own] += attacksKing;
+		int extra = moves - _expectedMobility[static_cast<int>(type)];
+		scores[own].middlegame += _mobility[static_cast<int>(type)].middlegame * extra;
+		scores[own].endgame += _mobility[static_cast<int>(type)].endgame * extra;
+	}
+
+	for (auto color : { Color::Black, Color::White }) {
+		int own = static_cast<int>(color);
+		int enemy = static_cast<int>(opposite(color));
+
+		if (bishops[own] >= 2)	scores[own] += _bishopPair;
+
+		//A lone attacker is rarely dangerous, the more join in the worse it gets
+		if (attackers[enemy] >= 2)
+			scores[own].middlegame -= std::min(attackUnits[enemy] * attackUnits[enemy], 200);
+
+		//Pawns in front of the king shelter it while the queens are on the board
+		auto king = position.kingSquare(color);
+		int forward = color == Color::White ? 8 : -8;
+		for (int file = king % 8 - 1; file <= king % 8 + 1; ++file) {
+			if (file < 0 || file > 7)	continue;
+			int front = king / 8 * 8 + file + forward;
+			if (front >= 0 && front < 64 && (pawns[own] & _bit(front)))
+				scores[own].middlegame += _shieldPawn;
+			else if (front + forward >= 0 && front + forward < 64 && (pawns[own] & _bit(front + forward)))
+				scores[own].middlegame += _shieldPawn / 2;
+		}
+	}
+
+	auto white = scores[static_cast<int>(Color::White)];
+	white -= scores[static_cast<int>(Color::Black)];
+	return white;
+}
+
+int evaluate(const SearchPosition& position, int alpha, int beta, PawnTable* pawnTable)
+{
+	//Scores past this would read as mates to the search
+	constexpr int limit = 10000;
+	if (auto network = position.evaluationNetwork())
+		return std::clamp(network->evaluate(position.accumulator(), position.sideToMove()), -limit, limit);
+
+	int phase = position.gamePhase();
+	TaperedScore score = { position.middlegameScore(), position.endgameScore() };
+
+	int sign = position.sideToMove() == Color::White ? 1 : -1;
+	int base = score.blend(phase) * sign;
+	if (base + _lazyMargin <= alpha || base - _lazyMargin >= beta)
+		return base;
+
+	score += _positionalTerms(position, pawnTable);
+	return score.blend(phase) * sign;
+}
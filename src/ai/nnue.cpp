@@ -0,0 +1,206 @@
+#include "../../include/ai/nnue.hpp"
+
+#include "../../include/profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NNUE_SSE2
+#endif
+
+/*
+	Quantization of the network: hidden neurons are clipped to 0 to activationLimit,
+	output weights are scaled by outputQuantization and the output is scaled
+	to centipawns by outputScale.
+*/
+static constexpr int _activationLimit = 255;
+static constexpr int _outputQuantization = 64;
+static constexpr int _outputScale = 400;
+
+static constexpr char _magic[4] = { 'C', 'N', 'U', 'E' };
+static constexpr uint32_t _version = 1;
+
+/*
+	Reads little-endian numbers, as long as the stream is good.
+*/
+template<typename T>
+static bool _read(std::istream& in, T* values, size_t count) {
+	std::vector<unsigned char> bytes(count * sizeof(T));
+	if (!in.read(reinterpret_cast<char*>(bytes.data()), bytes.size()))
+		return false;
+
+	for (size_t idx = 0; idx < count; ++idx) {
+		std::make_unsigned_t<T> value = 0;
+		for (size_t byte = 0; byte < sizeof(T); ++byte)
+			value |= static_cast<std::make_unsigned_t<T>>(bytes[idx * sizeof(T) + byte]) << (8 * byte);
+		std::memcpy(&values[idx], &value, sizeof(T));
+	}
+
+	return true;
+}
+
+bool Network::load(const std::string& path)
+{
+	ProfileDeclare;
+	std::ifstream in{ path, std::ios::binary };
+	if (!in)	return false;
+
+	char magic[4];
+	uint32_t header[2];
+	if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, _magic, sizeof(magic))
+		|| !_read(in, header, 2) || header[0] != _version || header[1] != hidden)
+		return false;
+
+	std::vector<int16_t> weights(inputs * hidden);
+	std::vector<int16_t> biases(hidden);
+	std::vector<int8_t> output(2 * hidden);
+	int32_t bias = 0;
+
+	if (!_read(in, weights.data(), weights.size()) || !_read(in, biases.data(), biases.size())
+		|| !_read(in, output.data(), output.size()) || !_read(in, &bias, 1))
+		return false;
+
+	featureWeights = std::move(weights);
+	featureBiases = std::move(biases);
+	outputWeights = std::move(output);
+	outputBias = bias;
+	return true;
+}
+
+const int16_t* Network::_weights(piece_t piece, square_t square, Color perspective) const
+{
+	//Black sees the board upside down with the colors swapped,
+	//so both players see their own pieces the same way
+	int type = static_cast<int>(pieceType(piece));
+	bool own = pieceColor(piece) == perspective;
+	int seen = perspective == Color::White ? square : square ^ 56;
+
+	int input = ((own ? 0 : 6) + type) * 64 + seen;
+	return featureWeights.data() + input * hidden;
+}
+
+/*
+	Adds or subtracts a row of weights into a row of the accumulator.
+*/
+template<bool subtract>
+inline void _update(int16_t* values, const int16_t* weights) {
+#if defined(__AVX2__)
+	for (int idx = 0; idx < Network::hidden; idx += 16) {
+		auto value = _mm256_load_si256(reinterpret_cast<const __m256i*>(values + idx));
+		auto weight = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + idx));
+		value = subtract ? _mm256_sub_epi16(value, weight) : _mm256_add_epi16(value, weight);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(values + idx), value);
+	}
+#elif defined(NNUE_SSE2)
+	for (int idx = 0; idx < Network::hidden; idx += 8) {
+		auto value = _mm_load_si128(reinterpret_cast<const __m128i*>(values + idx));
+		auto weight = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + idx));
+		value = subtract ? _mm_sub_epi16(value, weight) : _mm_add_epi16(value, weight);
+		_mm_store_si128(reinterpret_cast<__m128i*>(values + idx), value);
+	}
+#else
+	for (int idx = 0; idx < Network::hidden; ++idx)
+		values[idx] = static_cast<int16_t>(subtract ? values[idx] - weights[idx] : values[idx] + weights[idx]);
+#endif
+}
+
+/*
+	Sum of the clipped hidden neurons times their output weights.
+*/
+inline int32_t _output(const int16_t* values, const int8_t* weights) {
+#if defined(__AVX2__)
+	auto zero = _mm256_setzero_si256();
+	auto limit = _mm256_set1_epi16(_activationLimit);
+	auto sum = _mm256_setzero_si256();
+
+	for (int idx = 0; idx < Network::hidden; idx += 16) {
+		auto value = _mm256_load_si256(reinterpret_cast<const __m256i*>(values + idx));
+		value = _mm256_min_epi16(_mm256_max_epi16(value, zero), limit);
+		auto weight = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + idx)));
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(value, weight));
+	}
+
+	auto half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+	return _mm_cvtsi128_si32(half);
+#elif defined(NNUE_SSE2)
+	auto zero = _mm_setzero_si128();
+	auto limit = _mm_set1_epi16(_activationLimit);
+	auto sum = _mm_setzero_si128();
+
+	for (int idx = 0; idx < Network::hidden; idx += 16) {
+		//Bytes are widened to words by pairing each with itself and shifting the copy out
+		auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + idx));
+		auto low = _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+		auto high = _mm_srai_epi16(_mm_unpackhi_epi8(bytes, bytes), 8);
+
+		auto first = _mm_load_si128(reinterpret_cast<const __m128i*>(values + idx));
+		auto second = _mm_load_si128(reinterpret_cast<const __m128i*>(values + idx + 8));
+		first = _mm_min_epi16(_mm_max_epi16(first, zero), limit);
+		second = _mm_min_epi16(_mm_max_epi16(second, zero), limit);
+
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(first, low));
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(second, high));
+	}
+
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+	return _mm_cvtsi128_si32(sum);
+#else
+	int32_t sum = 0;
+	for (int idx = 0; idx < Network::hidden; ++idx)
+		sum += std::clamp<int32_t>(values[idx], 0, _activationLimit) * weights[idx];
+	return sum;
+#endif
+}
+
+void Network::refresh(Accumulator& accumulator, const SearchPosition& position) const
+{
+	for (auto perspective : { Color::Black, Color::White }) {
+		auto& values = accumulator.values[static_cast<int>(perspective)];
+		std::copy(featureBiases.begin(), featureBiases.end(), values.begin());
+
+		for (square_t square = 0; square < 64; ++square)
+			if (position.at(square))
+				_update<false>(values.data(), _weights(position.at(square), square, perspective));
+	}
+}
+
+void Network::add(Accumulator& accumulator, piece_t piece, square_t square) const
+{
+	for (auto perspective : { Color::Black, Color::White })
+		_update<false>(accumulator.values[static_cast<int>(perspective)].data(), _weights(piece, square, perspective));
+}
+
+void Network::remove(Accumulator& accumulator, piece_t piece, square_t square) const
+{
+	for (auto perspective : { Color::Black, Color::White })
+		_update<true>(accumulator.values[static_cast<int>(perspective)].data(), _weights(piece, square, perspective));
+}
+
+int Network::evaluate(const Accumulator& accumulator, Color side) const
+{
+	int32_t sum = _output(accumulator.values[static_cast<int>(side)].data(), outputWeights.data())
+		+ _output(accumulator.values[static_cast<int>(opposite(side))].data(), outputWeights.data() + hidden);
+
+	return static_cast<int>((static_cast<int64_t>(sum) + outputBias) * _outputScale
+							/ (_activationLimit * _outputQuantization));
+}
+
+const char* Network::instructionSet()
+{
+#if defined(__AVX2__)
+	return "AVX2";
+#elif defined(NNUE_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,31 @@
+#include "../../include/ai/pawntable.hpp"
+
+#include "../../include/profiler.hpp"
+
+PawnTable::PawnTable(size_t kilobytes)
+{
+	ProfileDeclare;
+	//A power of two, so the key is masked instead of divided
+	size_t count = 1;
+	while (count * 2 * sizeof(PawnEntry) <= kilobytes * 1024)
+		count *= 2;
+
+	entries.resize(count);
+}
+
+PawnEntry& PawnTable::probe(uint64_t key, bool& found)
+{
+	++probes;
+	auto& entry = entries[key & (entries.size() - 1)];
+	found = entry.key == key;
+	hits += found;
+	return entry;
+}
+
+void PawnTable::clear()
+{
+	ProfileDeclare;
+	std::fill(entries.begin(), entries.end(), PawnEntry{});
+	probes = 0;
+	hits = 0;
+}
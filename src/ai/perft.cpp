@@ -0,0 +1,39 @@
+#include "../../include/ai/perft.hpp"
+#include "../../include/ai/transposition.hpp"
+
+/*
+	Counts at different depths of the same position must not mix,
+	so the depth is folded into the key.
+*/
+inline uint64_t _perftKey(const SearchPosition& position, int depth) {
+	return position.hash() ^ (static_cast<uint64_t>(depth) * 0x9E3779B97F4A7C15ull);
+}
+
+uint64_t perft(SearchPosition& position, int depth, TranspositionTable* table)
+{
+	if (depth <= 0)	return 1;
+
+	uint64_t key = 0;
+	if (table && depth > 1) {
+		key = _perftKey(position, depth);
+		TTEntry entry;
+		if (table->probe(key, entry) && entry.depth == depth)
+			return entry.payload;
+	}
+
+	MoveList moves;
+	position.generate(moves);
+
+	uint64_t count = 0;
+	for (auto& move : moves) {
+		if (!position.makeMove(move))	continue;
+		count += depth == 1 ? 1 : perft(position, depth - 1, table);
+		position.unmakeMove();
+	}
+
+	//Counts that do not fit the payload are simply not stored
+	if (table && depth > 1 && count <= TTEntry::payloadMask)
+		table->store(key, depth, Bound::Exact, count);
+
+	return count;
+}
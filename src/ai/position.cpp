@@ -0,0 +1,679 @@
+#include "../../include/ai/position.hpp"
+#include "../../include/ai/evaluation.hpp"
+#include "../../include/ai/nnue.hpp"
+#include "../../include/boards/genericboard.hpp"
+#include "../../include/pieces/generic.hpp"
+
+#include "../../include/profiler.hpp"
+#include "../../include/stringutil.hpp"
+#include "../../include/ui/conactions.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std::string_literals;
+
+static constexpr std::array<int, 2> _knightSteps[8] = {
+	{ 1, 2 }, { 2, 1 }, { 2, -1 }, { 1, -2 }, { -1, -2 }, { -2, -1 }, { -2, 1 }, { -1, 2 }
+};
+
+static constexpr std::array<int, 2> _kingSteps[8] = {
+	{ 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 }
+};
+
+static constexpr std::array<int, 2> _bishopDirections[4] = {
+	{ 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 }
+};
+
+static constexpr std::array<int, 2> _rookDirections[4] = {
+	{ 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }
+};
+
+inline bool _onBoard(int rank, int file) {
+	return rank >= 0 && rank < 8 && file >= 0 && file < 8;
+}
+
+/*
+	Squares a knight or a king reaches from every square, computed once.
+*/
+struct StepTargets {
+	std::array<std::array<square_t, 8>, 64> targets;
+	std::array<int, 64> count;
+
+	StepTargets(const std::array<int, 2>* steps) {
+		for (int square = 0; square < 64; ++square) {
+			count[square] = 0;
+			for (int idx = 0; idx < 8; ++idx) {
+				int rank = square / 8 + steps[idx][0];
+				int file = square % 8 + steps[idx][1];
+				if (_onBoard(rank, file))
+					targets[square][count[square]++] = static_cast<square_t>(rank * 8 + file);
+			}
+		}
+	}
+};
+
+static const StepTargets _knightTargets{ _knightSteps };
+static const StepTargets _kingTargets{ _kingSteps };
+
+/*
+	Castling rights kept after a move from or to every square, only moves
+	from or onto the squares of kings and rooks take some away.
+*/
+static const std::array<uint8_t, 64> _castlingMask = [] {
+	std::array<uint8_t, 64> mask;
+	mask.fill(0xF);
+	mask[0] &= ~SearchPosition::WhiteQueenSide;
+	mask[7] &= ~SearchPosition::WhiteKingSide;
+	mask[4] &= ~(SearchPosition::WhiteKingSide | SearchPosition::WhiteQueenSide);
+	mask[56] &= ~SearchPosition::BlackQueenSide;
+	mask[63] &= ~SearchPosition::BlackKingSide;
+	mask[60] &= ~(SearchPosition::BlackKingSide | SearchPosition::BlackQueenSide);
+	return mask;
+}();
+
+/*
+	Random keys of the Zobrist hash, a position hashes to the XOR of the keys
+	of everything in it. The seed is fixed, so hashes stay the same between runs.
+*/
+struct ZobristKeys {
+	uint64_t pieces[16][64];	/**< Indexed by piece_t, then by square. */
+	uint64_t blackToMove;
+	uint64_t castling[16];
+	uint64_t enPassant[8];		/**< Indexed by file. */
+
+	ZobristKeys() {
+		uint64_t state = 0x9E3779B97F4A7C15ull;
+		auto _next = [&state]() {
+			//splitmix64
+			uint64_t value = (state += 0x9E3779B97F4A7C15ull);
+			value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+			value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+			return value ^ (value >> 31);
+		};
+
+		for (auto& piece : pieces)
+			for (auto& key : piece)
+				key = _next();
+		blackToMove = _next();
+		for (auto& key : castling)	key = _next();
+		for (auto& key : enPassant)	key = _next();
+	}
+};
+
+static const ZobristKeys _zobrist;
+
+std::string Move::toString() const
+{
+	if (isNone())	return "0000"s;
+
+	std::string str = positionToString(toPosition(from)) + positionToString(toPosition(to));
+	if (promotion != PieceType::None)
+		str += static_cast<char>(std::tolower(typeToCharRaw(promotion)));
+	return str;
+}
+
+bool SearchPosition::load(const GenericBoard& board, const std::vector<uint64_t>& gameHashes)
+{
+	ProfileDeclare;
+	auto& state = board.getState();
+	if (state.width != 8 || state.height != 8)	return false;
+
+	squares.fill(noPiece);
+	kings = { -1, -1 };
+	enPassant = -1;
+	history.clear();
+	this->gameHashes = gameHashes;
+
+	for (int rank = 0; rank < 8; ++rank) {
+		for (int file = 0; file < 8; ++file) {
+			auto& piece = state.squares[rank][file].piecePtr;
+			if (!piece)	continue;
+
+			auto square = static_cast<square_t>(rank * 8 + file);
+			auto type = piece->getType();
+			auto color = piece->getColor();
+
+			if (type == PieceType::ShadowPawn) {
+				enPassant = square;
+				continue;
+			}
+			if (type == PieceType::None)	continue;
+
+			squares[square] = makePiece(type, color);
+			if (type == PieceType::King) {
+				if (kings[static_cast<int>(color)] != -1)	return false;
+				kings[static_cast<int>(color)] = square;
+			}
+		}
+	}
+
+	if (kings[0] == -1 || kings[1] == -1)	return false;
+
+	side = board.getPlayingColor();
+	if (side != Color::White && side != Color::Black)
+		side = Color::White;
+
+	//A right is kept while neither the king nor the rook ever left its square
+	auto _canCastle = [&state, this](int rank, int rookFile, Color color) {
+		auto& king = state.squares[rank][4];
+		auto& rook = state.squares[rank][rookFile];
+		return squares[rank * 8 + 4] == makePiece(PieceType::King, color) && !king.didMove
+			&& squares[rank * 8 + rookFile] == makePiece(PieceType::Rook, color) && !rook.didMove;
+	};
+
+	castling = 0;
+	if (_canCastle(0, 7, Color::White))	castling |= WhiteKingSide;
+	if (_canCastle(0, 0, Color::White))	castling |= WhiteQueenSide;
+	if (_canCastle(7, 7, Color::Black))	castling |= BlackKingSide;
+	if (_canCastle(7, 0, Color::Black))	castling |= BlackQueenSide;
+
+	halfmove = board.getHalfmoveClock();
+	_computeHashes();
+	_computeScores();
+
+	accumulators.clear();
+	if (network) {
+		accumulators.reserve(256);
+		accumulators.emplace_back();
+		network->refresh(accumulators.back(), *this);
+	}
+
+	return true;
+}
+
+void SearchPosition::useNetwork(const Network* network)
+{
+	this->network = network && network->isLoaded() ? network : nullptr;
+}
+
+void SearchPosition::_computeScores()
+{
+	TaperedScore score;
+	phase = 0;
+	for (square_t square = 0; square < 64; ++square) {
+		if (!squares[square])	continue;
+		score += pieceSquareScore(squares[square], square);
+		phase += phaseWeight(pieceType(squares[square]));
+	}
+
+	middlegame = score.middlegame;
+	endgame = score.endgame;
+}
+
+void SearchPosition::_place(piece_t piece, square_t square)
+{
+	auto& score = pieceSquareScore(piece, square);
+	squares[square] = piece;
+	key ^= _zobrist.pieces[piece][square];
+	if (pieceType(piece) == PieceType::Pawn)
+		pawnKey ^= _zobrist.pieces[piece][square];
+	if (network)	network->add(accumulators.back(), piece, square);
+	middlegame += score.middlegame;
+	endgame += score.endgame;
+	phase += phaseWeight(pieceType(piece));
+}
+
+void SearchPosition::_remove(square_t square)
+{
+	auto piece = squares[square];
+	auto& score = pieceSquareScore(piece, square);
+	squares[square] = noPiece;
+	key ^= _zobrist.pieces[piece][square];
+	if (pieceType(piece) == PieceType::Pawn)
+		pawnKey ^= _zobrist.pieces[piece][square];
+	if (network)	network->remove(accumulators.back(), piece, square);
+	middlegame -= score.middlegame;
+	endgame -= score.endgame;
+	phase -= phaseWeight(pieceType(piece));
+}
+
+void SearchPosition::_computeHashes()
+{
+	key = 0;
+	pawnKey = 0;
+	for (square_t square = 0; square < 64; ++square) {
+		if (!squares[square])	continue;
+		key ^= _zobrist.pieces[squares[square]][square];
+		if (pieceType(squares[square]) == PieceType::Pawn)
+			pawnKey ^= _zobrist.pieces[squares[square]][square];
+	}
+
+	if (side == Color::Black)	key ^= _zobrist.blackToMove;
+	key ^= _zobrist.castling[castling];
+	if (enPassant >= 0)	key ^= _zobrist.enPassant[enPassant % 8];
+}
+
+bool SearchPosition::isRepetition() const
+{
+	//The same player has to be on the move, so only every other position can match
+	//Positions before the load are looked up in the game once history runs out
+	int loaded = static_cast<int>(history.size());
+	int back = std::min<int>(halfmove, loaded + static_cast<int>(gameHashes.size()));
+	for (int plies = 4; plies <= back; plies += 2) {
+		auto hash = plies <= loaded ? history[loaded - plies].hash
+			: gameHashes[gameHashes.size() - (plies - loaded)];
+		if (hash == key)
+			return true;
+	}
+
+	return false;
+}
+
+void SearchPosition::_generatePawn(square_t from, MoveList& list, bool quiets) const
+{
+	int forward = side == Color::White ? 8 : -8;
+	int rank = from / 8;
+	int file = from % 8;
+	int startRank = side == Color::White ? 1 : 6;
+	int lastRank = side == Color::White ? 6 : 1;
+
+	//Without quiet moves, promotions are only made to a queen
+	auto _push = [&list, rank, lastRank, from, quiets](square_t to) {
+		if (rank != lastRank) {
+			list.push(from, to);
+			return;
+		}
+		list.push(from, to, PieceType::Queen);
+		if (quiets)
+			for (auto type : { PieceType::Knight, PieceType::Rook, PieceType::Bishop })
+				list.push(from, to, type);
+	};
+
+	auto ahead = static_cast<square_t>(from + forward);
+	if (!squares[ahead] && (quiets || rank == lastRank)) {
+		_push(ahead);
+		auto twoAhead = static_cast<square_t>(ahead + forward);
+		if (quiets && rank == startRank && !squares[twoAhead])
+			list.push(from, twoAhead);
+	}
+
+	for (int side_ : { -1, 1 }) {
+		if (file + side_ < 0 || file + side_ > 7)	continue;
+		auto to = static_cast<square_t>(ahead + side_);
+		if ((squares[to] && pieceColor(squares[to]) != side) || to == enPassant)
+			_push(to);
+	}
+}
+
+void SearchPosition::_generateSliding(square_t from, const std::array<int, 2>* directions,
+									  int count, MoveList& list, bool quiets) const
+{
+	for (int idx = 0; idx < count; ++idx) {
+		int rank = from / 8 + directions[idx][0];
+		int file = from % 8 + directions[idx][1];
+
+		for (; _onBoard(rank, file); rank += directions[idx][0], file += directions[idx][1]) {
+			auto to = static_cast<square_t>(rank * 8 + file);
+			if (squares[to]) {
+				if (pieceColor(squares[to]) != side)
+					list.push(from, to);
+				break;
+			}
+			if (quiets)
+				list.push(from, to);
+		}
+	}
+}
+
+void SearchPosition::_generateCastling(MoveList& list) const
+{
+	int rank = side == Color::White ? 0 : 7;
+	auto king = static_cast<square_t>(rank * 8 + 4);
+	auto kingSide = side == Color::White ? WhiteKingSide : BlackKingSide;
+	auto queenSide = side == Color::White ? WhiteQueenSide : BlackQueenSide;
+	auto enemy = opposite(side);
+
+	if (!(castling & (kingSide | queenSide)) || isAttacked(king, enemy))
+		return;
+
+	//The square the king lands on is tested when the move is made
+	if ((castling & kingSide) && !squares[king + 1] && !squares[king + 2]
+		&& !isAttacked(king + 1, enemy))
+		list.push(king, king + 2);
+
+	if ((castling & queenSide) && !squares[king - 1] && !squares[king - 2] && !squares[king - 3]
+		&& !isAttacked(king - 1, enemy))
+		list.push(king, king - 2);
+}
+
+void SearchPosition::_generate(MoveList& list, bool quiets) const
+{
+	for (square_t from = 0; from < 64; ++from) {
+		auto piece = squares[from];
+		if (!piece || pieceColor(piece) != side)	continue;
+
+		switch (pieceType(piece)) {
+		case PieceType::Pawn:
+			_generatePawn(from, list, quiets);
+			break;
+		case PieceType::Knight:
+		case PieceType::King: {
+			auto& steps = pieceType(piece) == PieceType::Knight ? _knightTargets : _kingTargets;
+			for (int idx = 0; idx < steps.count[from]; ++idx) {
+				auto to = steps.targets[from][idx];
+				if (squares[to] ? pieceColor(squares[to]) != side : quiets)
+					list.push(from, to);
+			}
+			break;
+		}
+		case PieceType::Bishop:
+			_generateSliding(from, _bishopDirections, 4, list, quiets);
+			break;
+		case PieceType::Rook:
+			_generateSliding(from, _rookDirections, 4, list, quiets);
+			break;
+		case PieceType::Queen:
+			_generateSliding(from, _bishopDirections, 4, list, quiets);
+			_generateSliding(from, _rookDirections, 4, list, quiets);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (quiets)
+		_generateCastling(list);
+}
+
+void SearchPosition::generate(MoveList& list) const
+{
+	ProfileDeclare;
+	_generate(list, true);
+}
+
+void SearchPosition::generateCaptures(MoveList& list) const
+{
+	_generate(list, false);
+}
+
+void SearchPosition::generateLegal(MoveList& list)
+{
+	ProfileDeclare;
+	MoveList all;
+	generate(all);
+
+	for (auto& move : all) {
+		if (makeMove(move)) {
+			unmakeMove();
+			list.push(move.from, move.to, move.promotion);
+		}
+	}
+}
+
+bool SearchPosition::makeMove(const Move& move)
+{
+	auto moved = squares[move.from];
+	auto type = pieceType(moved);
+
+	Undo undo{ move, moved, squares[move.to], move.to, castling, enPassant, halfmove, key, pawnKey,
+			   middlegame, endgame, phase };
+
+	//The accumulator of the new position starts as a copy of the current one
+	if (network)
+		accumulators.push_back(accumulators.back());
+
+	//Everything but the squares is hashed again once the move is played
+	key ^= _zobrist.castling[castling];
+	if (enPassant >= 0)	key ^= _zobrist.enPassant[enPassant % 8];
+
+	if (type == PieceType::Pawn && move.to == enPassant) {
+		undo.capturedOn = static_cast<square_t>(move.to + (side == Color::White ? -8 : 8));
+		undo.captured = squares[undo.capturedOn];
+	}
+	if (undo.captured)
+		_remove(undo.capturedOn);
+
+	_remove(move.from);
+	_place(move.promotion != PieceType::None ? makePiece(move.promotion, side) : moved, move.to);
+
+	if (type == PieceType::King) {
+		kings[static_cast<int>(side)] = move.to;
+
+		//Castling, the rook jumps over the king
+		if (std::abs(move.to - move.from) == 2) {
+			int rank = move.from / 8;
+			bool kingSide = move.to > move.from;
+			auto rookFrom = static_cast<square_t>(rank * 8 + (kingSide ? 7 : 0));
+			auto rookTo = static_cast<square_t>(rank * 8 + (kingSide ? 5 : 3));
+			auto rook = squares[rookFrom];
+			_remove(rookFrom);
+			_place(rook, rookTo);
+		}
+	}
+
+	castling &= _castlingMask[move.from] & _castlingMask[move.to];
+	enPassant = type == PieceType::Pawn && std::abs(move.to - move.from) == 16
+		? static_cast<square_t>((move.from + move.to) / 2) : -1;
+	halfmove = type == PieceType::Pawn || undo.captured ? 0 : halfmove + 1;
+
+	key ^= _zobrist.castling[castling] ^ _zobrist.blackToMove;
+	if (enPassant >= 0)	key ^= _zobrist.enPassant[enPassant % 8];
+
+	auto mover = side;
+	side = opposite(side);
+	history.push_back(undo);
+
+	if (isAttacked(kingSquare(mover), side)) {
+		unmakeMove();
+		return false;
+	}
+
+	return true;
+}
+
+void SearchPosition::unmakeMove()
+{
+	auto& undo = history.back();
+	auto& move = undo.move;
+
+	side = opposite(side);
+
+	squares[move.from] = undo.moved;
+	squares[move.to] = noPiece;
+	squares[undo.capturedOn] = undo.captured;
+
+	if (pieceType(undo.moved) == PieceType::King) {
+		kings[static_cast<int>(side)] = move.from;
+
+		if (std::abs(move.to - move.from) == 2) {
+			int rank = move.from / 8;
+			bool kingSide = move.to > move.from;
+			auto rookFrom = static_cast<square_t>(rank * 8 + (kingSide ? 7 : 0));
+			auto rookTo = static_cast<square_t>(rank * 8 + (kingSide ? 5 : 3));
+			squares[rookFrom] = squares[rookTo];
+			squares[rookTo] = noPiece;
+		}
+	}
+
+	castling = undo.castling;
+	enPassant = undo.enPassant;
+	halfmove = undo.halfmove;
+	key = undo.hash;
+	pawnKey = undo.pawnHash;
+	middlegame = undo.middlegame;
+	endgame = undo.endgame;
+	phase = undo.phase;
+	if (network)
+		accumulators.pop_back();
+
+	history.pop_back();
+}
+
+void SearchPosition::makeNullMove()
+{
+	//The move itself is none, so only the flags are restored
+	history.push_back({ Move{}, noPiece, noPiece, -1, castling, enPassant, halfmove, key, pawnKey,
+						middlegame, endgame, phase });
+
+	if (enPassant >= 0)	key ^= _zobrist.enPassant[enPassant % 8];
+	key ^= _zobrist.blackToMove;
+	enPassant = -1;
+
+	//Positions before a null move cannot really repeat after it
+	halfmove = 0;
+	side = opposite(side);
+}
+
+void SearchPosition::unmakeNullMove()
+{
+	auto& undo = history.back();
+	side = opposite(side);
+	enPassant = undo.enPassant;
+	halfmove = undo.halfmove;
+	key = undo.hash;
+	history.pop_back();
+}
+
+bool SearchPosition::hasNonPawnMaterial(Color color) const
+{
+	for (auto piece : squares) {
+		if (pieceColor(piece) != color)	continue;
+		auto type = pieceType(piece);
+		if (type != PieceType::Pawn && type != PieceType::King)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+	Value of pieces in exchanges, the king is worth more than anything
+	it could win, so it only captures last.
+*/
+inline int _exchangeValue(piece_t piece) {
+	return pieceType(piece) == PieceType::King ? 10000 : pieceValue(pieceType(piece));
+}
+
+/*
+	Square of the cheapest piece of a player that attacks a square, -1 if none does.
+	Sliders are found through the squares already emptied on the board.
+*/
+static square_t _leastValuableAttacker(const std::array<piece_t, 64>& board, square_t square, Color byColor)
+{
+	int rank = square / 8;
+	int file = square % 8;
+
+	int pawnRank = rank + (byColor == Color::White ? -1 : 1);
+	auto pawn = makePiece(PieceType::Pawn, byColor);
+	for (int side_ : { -1, 1 }) {
+		if (_onBoard(pawnRank, file + side_) && board[pawnRank * 8 + file + side_] == pawn)
+			return static_cast<square_t>(pawnRank * 8 + file + side_);
+	}
+
+	auto knight = makePiece(PieceType::Knight, byColor);
+	for (int idx = 0; idx < _knightTargets.count[square]; ++idx)
+		if (board[_knightTargets.targets[square][idx]] == knight)
+			return _knightTargets.targets[square][idx];
+
+	//The first piece along every ray, kept by type
+	std::array<square_t, 3> sliders = { -1, -1, -1 };
+	auto queen = makePiece(PieceType::Queen, byColor);
+
+	auto _slides = [&](const std::array<int, 2>* directions, piece_t slider, square_t& found) {
+		for (int idx = 0; idx < 4; ++idx) {
+			int r = rank + directions[idx][0];
+			int f = file + directions[idx][1];
+			for (; _onBoard(r, f); r += directions[idx][0], f += directions[idx][1]) {
+				auto piece = board[r * 8 + f];
+				if (!piece)	continue;
+				if (piece == slider)	found = static_cast<square_t>(r * 8 + f);
+				else if (piece == queen)	sliders[2] = static_cast<square_t>(r * 8 + f);
+				break;
+			}
+		}
+	};
+
+	_slides(_bishopDirections, makePiece(PieceType::Bishop, byColor), sliders[0]);
+	_slides(_rookDirections, makePiece(PieceType::Rook, byColor), sliders[1]);
+	for (auto found : sliders)
+		if (found >= 0)	return found;
+
+	auto king = makePiece(PieceType::King, byColor);
+	for (int idx = 0; idx < _kingTargets.count[square]; ++idx)
+		if (board[_kingTargets.targets[square][idx]] == king)
+			return _kingTargets.targets[square][idx];
+
+	return -1;
+}
+
+int SearchPosition::staticExchange(const Move& move) const
+{
+	auto board = squares;
+	auto mover = board[move.from];
+	auto color = pieceColor(mover);
+
+	//gain[n] is what the player making the n-th capture wins, if it is the last one
+	std::array<int, 32> gain;
+	gain[0] = _exchangeValue(board[move.to]);
+
+	if (pieceType(mover) == PieceType::Pawn && move.to == enPassant) {
+		board[move.to + (color == Color::White ? -8 : 8)] = noPiece;
+		gain[0] = pieceValue(PieceType::Pawn);
+	}
+	if (move.promotion != PieceType::None) {
+		mover = makePiece(move.promotion, color);
+		gain[0] += pieceValue(move.promotion) - pieceValue(PieceType::Pawn);
+	}
+
+	board[move.from] = noPiece;
+	board[move.to] = mover;
+
+	int depth = 0;
+	auto turn = opposite(color);
+	while (depth < static_cast<int>(gain.size()) - 1) {
+		auto from = _leastValuableAttacker(board, move.to, turn);
+		if (from < 0)	break;
+
+		++depth;
+		gain[depth] = _exchangeValue(board[move.to]) - gain[depth - 1];
+		board[move.to] = board[from];
+		board[from] = noPiece;
+		turn = opposite(turn);
+	}
+
+	return resolveExchange(gain.data(), depth);
+}
+
+bool SearchPosition::isAttacked(square_t square, Color byColor) const
+{
+	int rank = square / 8;
+	int file = square % 8;
+
+	//Pawns attack forward, so look one rank back from their point of view
+	int pawnRank = rank + (byColor == Color::White ? -1 : 1);
+	auto pawn = makePiece(PieceType::Pawn, byColor);
+	for (int side_ : { -1, 1 }) {
+		if (_onBoard(pawnRank, file + side_) && squares[pawnRank * 8 + file + side_] == pawn)
+			return true;
+	}
+
+	auto knight = makePiece(PieceType::Knight, byColor);
+	for (int idx = 0; idx < _knightTargets.count[square]; ++idx)
+		if (squares[_knightTargets.targets[square][idx]] == knight)
+			return true;
+
+	auto king = makePiece(PieceType::King, byColor);
+	for (int idx = 0; idx < _kingTargets.count[square]; ++idx)
+		if (squares[_kingTargets.targets[square][idx]] == king)
+			return true;
+
+	auto queen = makePiece(PieceType::Queen, byColor);
+
+	auto _slides = [&](const std::array<int, 2>* directions, piece_t slider) {
+		for (int idx = 0; idx < 4; ++idx) {
+			int r = rank + directions[idx][0];
+			int f = file + directions[idx][1];
+			for (; _onBoard(r, f); r += directions[idx][0], f += directions[idx][1]) {
+				auto piece = squares[r * 8 + f];
+				if (!piece)	continue;
+				if (piece == slider || piece == queen)	return true;
+				break;
+			}
+		}
+		return false;
+	};
+
+	return _slides(_bishopDirections, makePiece(PieceType::Bishop, byColor))
+		|| _slides(_rookDirections, makePiece(PieceType::Rook, byColor));
+}
@@ -0,0 +1,635 @@
+#include "../../include/ai/search.hpp"
+#include "../../include/ai/evaluation.hpp"
+#include "../../include/ai/transposition.hpp"
+#include "../../include/boards/genericboard.hpp"
+
+#include "../../include/profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+/*
+	Mate scores count plies from the root, but a stored position can be
+	reached at any ply. They are stored counting from the position itself.
+*/
+inline int _scoreToTable(int score, int ply) {
+	if (score >= Search::mateScore - Search::maxPly)	return score + ply;
+	if (score <= -Search::mateScore + Search::maxPly)	return score - ply;
+	return score;
+}
+
+inline int _scoreFromTable(int score, int ply) {
+	if (score >= Search::mateScore - Search::maxPly)	return score - ply;
+	if (score <= -Search::mateScore + Search::maxPly)	return score + ply;
+	return score;
+}
+
+double Search::_elapsed() const
+{
+	return std::chrono::duration<double>(clock_t::now() - start).count();
+}
+
+uint64_t Search::_totalNodes() const
+{
+	uint64_t total = nodes;
+	for (auto& helper : helpers)
+		total += helper->publishedNodes.load(std::memory_order_relaxed);
+	return total;
+}
+
+bool Search::_outOfBudget()
+{
+	if (!(nodes & 1023))
+		publishedNodes.store(nodes, std::memory_order_relaxed);
+
+	//Helpers have no limits of their own, the main thread stops them
+	if (helperIndex)
+		return stopped;
+
+	//The first iteration is always finished, so there is a move to play,
+	//unless the game would be lost on time for it
+	if (iteration == 1 && !limits.clock.time)
+		return stopped;
+
+	//Helpers publish their nodes every 1024, so the limit may be passed by that much per helper
+	if (limits.nodes && _totalNodes() >= limits.nodes)
+		stopped = true;
+	//Reading the clock is not free, but every 256 nodes is still well
+	//under a millisecond, even on a machine busy with other work
+	else if (deadline && !(nodes & 255) && _elapsed() * 1000 >= deadline)
+		stopped = true;
+
+	return stopped;
+}
+
+bool Search::_isCapture(const Move& move) const
+{
+	return position.at(move.to)
+		|| (move.to == position.enPassantSquare() && pieceType(position.at(move.from)) == PieceType::Pawn);
+}
+
+/*
+	Ranks of the groups moves are ordered in, every group above all moves
+	of the groups below it.
+*/
+static constexpr int _pvScore = 1 << 30;
+static constexpr int _hashScore = (1 << 30) - 1;
+static constexpr int _captureScore = 1 << 28;
+static constexpr int _killerScore = 1 << 27;
+static constexpr int _historyLimit = 1 << 20;
+static constexpr int _losingCaptureScore = -(1 << 25);
+
+/*
+	A capture that cannot bring the score within this much of alpha
+	is not searched by the quiescence search.
+*/
+static constexpr int _deltaMargin = 200;
+
+/*
+	Margins of the selective techniques, by the depth left. Futility prunes
+	up to depth 3 when above beta and up to depth 2 when below alpha,
+	razoring up to depth 2.
+*/
+static constexpr std::array<int, 4> _futilityMargin = { 0, 150, 300, 450 };
+static constexpr std::array<int, 3> _razorMargin = { 0, 300, 550 };
+
+/*
+	Null move cutoffs from this depth on are verified by a search without
+	null moves, the deeper the search the more a missed zugzwang costs.
+*/
+static constexpr int _nullVerifyDepth = 8;
+
+/*
+	Plies a late quiet move is reduced by, growing slowly with both
+	the depth left and how late the move comes.
+*/
+static int _reduction(int depth, int moveNumber)
+{
+	static const auto table = [] {
+		std::array<std::array<int, 64>, 64> reductions = {};
+		for (int d = 1; d < 64; ++d)
+			for (int m = 1; m < 64; ++m)
+				reductions[d][m] = static_cast<int>(0.75 + std::log(d) * std::log(m) / 2.25);
+		return reductions;
+	}();
+
+	return table[std::min(depth, 63)][std::min(moveNumber, 63)];
+}
+
+void Search::_scoreMoves(const MoveList& moves, std::array<int, 256>& scores, int ply, const Move& hashMove)
+{
+	//Only the line that led here from the root follows the previous variation
+	bool pvFound = false;
+	auto side = static_cast<int>(position.sideToMove());
+
+	for (size_t idx = 0; idx < moves.size(); ++idx) {
+		auto& move = moves[idx];
+
+		if (followPv && ply < static_cast<int>(previousPv.size()) && move == previousPv[ply]) {
+			scores[idx] = _pvScore;
+			pvFound = true;
+		}
+		else if (move == hashMove) {
+			scores[idx] = _hashScore;
+		}
+		else if (_isCapture(move) || move.promotion == PieceType::Queen) {
+			//Most valuable victim first, least valuable attacker breaks ties
+			auto victim = position.at(move.to) ? pieceType(position.at(move.to)) : PieceType::Pawn;
+			if (move.promotion == PieceType::Queen && !position.at(move.to))
+				victim = PieceType::Queen;
+			auto attacker = pieceType(position.at(move.from));
+			int mvvLva = static_cast<int>(victim) * 8 - static_cast<int>(attacker);
+
+			//Captures that lose material wait until after the quiet moves
+			bool losing = pieceValue(attacker) > pieceValue(victim) && position.staticExchange(move) < 0;
+			scores[idx] = (losing ? _losingCaptureScore : _captureScore) + mvvLva;
+		}
+		else if (move.promotion != PieceType::None) {
+			//Underpromotions are hardly ever the best move
+			scores[idx] = -_historyLimit;
+		}
+		else if (move == killers[ply][0]) {
+			scores[idx] = _killerScore;
+		}
+		else if (move == killers[ply][1]) {
+			scores[idx] = _killerScore - 1;
+		}
+		else {
+			scores[idx] = history[side][move.from][move.to];
+
+			//Helpers order quiet moves a little differently each, so threads
+			//spread over the tree instead of all searching the same moves
+			if (helperIndex)
+				scores[idx] += (move.from * 31 + move.to * 17 + helperIndex * 57 + ply) & 63;
+		}
+	}
+
+	if (!pvFound)
+		followPv = false;
+}
+
+void Search::_updateQuiet(const Move& move, int depth, int ply)
+{
+	if (killers[ply][0] != move) {
+		killers[ply][1] = killers[ply][0];
+		killers[ply][0] = move;
+	}
+
+	auto& entry = history[static_cast<int>(position.sideToMove())][move.from][move.to];
+	entry += depth * depth;
+
+	//Halving keeps the scores below the killers and lets newer cutoffs weigh more
+	if (entry >= _historyLimit)
+		for (auto& color : history)
+			for (auto& from : color)
+				for (auto& value : from)
+					value /= 2;
+}
+
+int Search::_quiescence(int alpha, int beta, int ply)
+{
+	pvLength[ply] = ply;
+
+	++nodes;
+	if (_outOfBudget())	return 0;
+
+	if (ply >= maxPly - 1)
+		return evaluate(position, -infinity, infinity, &pawnTable);
+
+	//In check, every evasion is searched and there is no standing pat, the check has to be answered
+	bool inCheck = position.inCheck();
+	int best = -infinity;
+
+	//The player to move can always stop capturing and keep the static score
+	if (!inCheck) {
+		best = evaluate(position, alpha, beta, &pawnTable);
+		if (best >= beta)	return best;
+		alpha = std::max(alpha, best);
+	}
+
+	MoveList moves;
+	if (inCheck)
+		position.generate(moves);
+	else
+		position.generateCaptures(moves);
+
+	std::array<int, 256> scores;
+	for (size_t idx = 0; idx < moves.size(); ++idx) {
+		auto& move = moves[idx];
+		auto attacker = pieceType(position.at(move.from));
+
+		//Quiet evasions go after all captures
+		if (inCheck) {
+			scores[idx] = position.at(move.to) ? static_cast<int>(pieceType(position.at(move.to))) * 8
+				- static_cast<int>(attacker) : -64;
+			continue;
+		}
+
+		auto victim = position.at(move.to) ? pieceType(position.at(move.to)) : PieceType::Pawn;
+		int gain = pieceValue(victim);
+		if (move.promotion != PieceType::None)
+			gain += pieceValue(move.promotion) - pieceValue(PieceType::Pawn);
+
+		//Delta pruning, not even winning the piece for free would reach alpha
+		if (best + gain + _deltaMargin <= alpha) {
+			scores[idx] = _losingCaptureScore;
+			continue;
+		}
+
+		bool losing = pieceValue(attacker) > pieceValue(victim) && position.staticExchange(move) < 0;
+		scores[idx] = losing ? _losingCaptureScore : static_cast<int>(victim) * 8 - static_cast<int>(attacker);
+	}
+
+	bool anyLegal = false;
+	for (size_t idx = 0; idx < moves.size(); ++idx) {
+		auto picked = std::max_element(scores.begin() + idx, scores.begin() + moves.size()) - scores.begin();
+		std::swap(moves[idx], moves[picked]);
+		std::swap(scores[idx], scores[picked]);
+
+		//Only losing or pruned captures are left
+		if (scores[idx] == _losingCaptureScore)	break;
+
+		auto& move = moves[idx];
+		if (!position.makeMove(move))	continue;
+		anyLegal = true;
+		int score = -_quiescence(-beta, -alpha, ply + 1);
+		position.unmakeMove();
+
+		if (stopped)	return 0;
+
+		if (score > best) {
+			best = score;
+			if (score > alpha) {
+				alpha = score;
+				if (alpha >= beta)	break;
+			}
+		}
+	}
+
+	if (inCheck && !anyLegal)
+		return -mateScore + ply;
+
+	return best;
+}
+
+int Search::_negamax(int depth, int alpha, int beta, int ply, bool allowNull)
+{
+	pvLength[ply] = ply;
+
+	++nodes;
+	if (_outOfBudget())	return 0;
+
+	if (ply && position.isRepetition())
+		return 0;
+
+	//Mate takes precedence over the fifty-move rule
+	if (ply && position.halfmoveClock() >= 100) {
+		if (!position.inCheck())	return 0;
+
+		MoveList legal;
+		position.generateLegal(legal);
+		return legal.size() ? 0 : -mateScore + ply;
+	}
+
+	if (ply >= maxPly - 1)
+		return evaluate(position, -infinity, infinity, &pawnTable);
+
+	bool inCheck = position.inCheck();
+
+	//A check is searched a ply deeper, so the horizon never hides what it leads to
+	if (inCheck && features.checkExtensions)
+		++depth;
+
+	if (depth <= 0)
+		return _quiescence(alpha, beta, ply);
+
+	bool pvNode = beta - alpha > 1;
+	Move hashMove;
+	TTEntry entry;
+
+	if (table && table->probe(position.hash(), entry)) {
+		hashMove = entry.move();
+
+		//Principal variation nodes are always searched, so the variation stays whole
+		if (!pvNode && entry.depth >= depth) {
+			int score = _scoreFromTable(entry.score(), ply);
+			if (entry.bound == Bound::Exact
+				|| (entry.bound == Bound::Lower && score >= beta)
+				|| (entry.bound == Bound::Upper && score <= alpha))
+				return score;
+		}
+	}
+
+	//Positions are only pruned away from the principal variation, out of check
+	//and with no mate in the window, so no forced line is ever cut off
+	bool canPrune = !pvNode && !inCheck && std::abs(beta) < mateScore - maxPly
+		&& (features.nullMove || features.futility || features.razoring);
+	int staticEval = canPrune ? evaluate(position, -infinity, infinity, &pawnTable) : 0;
+
+	if (canPrune) {
+		//So far above beta near the leaves that the opponent cannot come back
+		if (features.futility && depth <= 3 && staticEval - _futilityMargin[depth] >= beta)
+			return staticEval;
+
+		//So far below alpha near the leaves that only captures could help
+		if (features.razoring && depth <= 2 && staticEval + _razorMargin[depth] <= alpha) {
+			int score = _quiescence(alpha, beta, ply);
+			if (score <= alpha)	return score;
+		}
+
+		//If passing the turn still holds beta, a real move will too. Without pieces
+		//zugzwang is likely, and two null moves in a row would only waste depth.
+		if (features.nullMove && allowNull && depth >= 3 && staticEval >= beta
+			&& position.hasNonPawnMaterial(position.sideToMove())) {
+			int reduction = 3 + depth / 6;
+
+			position.makeNullMove();
+			int score = -_negamax(depth - 1 - reduction, -beta, -beta + 1, ply + 1, false);
+			position.unmakeNullMove();
+
+			if (stopped)	return 0;
+
+			if (score >= beta) {
+				//A mate found after passing is no proof of one
+				if (score >= mateScore - maxPly)
+					score = beta;
+
+				if (depth < _nullVerifyDepth
+					|| _negamax(depth - 1 - reduction, beta - 1, beta, ply, false) >= beta)
+					return score;
+			}
+		}
+	}
+
+	//Quiet moves cannot bring a score this far below alpha back up
+	bool futile = canPrune && features.futility && depth <= 2
+		&& staticEval + _futilityMargin[depth] <= alpha;
+
+	MoveList moves;
+	position.generate(moves);
+
+	std::array<int, 256> scores;
+	_scoreMoves(moves, scores, ply, hashMove);
+
+	int originalAlpha = alpha;
+	int legal = 0;
+	int best = -infinity;
+	Move bestMove;
+
+	for (size_t idx = 0; idx < moves.size(); ++idx) {
+		//Only the best of the remaining moves is picked, a cutoff often comes early
+		auto picked = std::max_element(scores.begin() + idx, scores.begin() + moves.size()) - scores.begin();
+		std::swap(moves[idx], moves[picked]);
+		std::swap(scores[idx], scores[picked]);
+
+		auto& move = moves[idx];
+		bool quiet = move.promotion == PieceType::None && !_isCapture(move);
+
+		if (!ply && std::find(excludedRoot.begin(), excludedRoot.end(), move) != excludedRoot.end())
+			continue;
+
+		if (!position.makeMove(move))	continue;
+		++legal;
+
+		bool givesCheck = position.inCheck();
+		if (futile && quiet && legal > 1 && !givesCheck) {
+			position.unmakeMove();
+			continue;
+		}
+
+		if (table)	table->prefetch(position.hash());
+
+		int score;
+		if (legal == 1) {
+			score = -_negamax(depth - 1, -beta, -alpha, ply + 1);
+		}
+		else {
+			//Quiet moves ordered after the killers are rarely the best, so they
+			//are searched less deep first, and only fully if they beat alpha
+			int reduction = 0;
+			if (features.lateMoveReductions && depth >= 3 && quiet && !inCheck && !givesCheck
+				&& scores[idx] < _killerScore - 1) {
+				reduction = _reduction(depth, legal) - pvNode;
+				reduction = std::clamp(reduction, 0, depth - 2);
+			}
+
+			//Expect the first move to stay the best, prove it with a null window
+			score = -_negamax(depth - 1 - reduction, -alpha - 1, -alpha, ply + 1);
+			if (reduction && score > alpha)
+				score = -_negamax(depth - 1, -alpha - 1, -alpha, ply + 1);
+			if (score > alpha && score < beta)
+				score = -_negamax(depth - 1, -beta, -alpha, ply + 1);
+		}
+
+		position.unmakeMove();
+		followPv = false;
+
+		if (stopped)	return 0;
+
+		if (score > best) {
+			best = score;
+			bestMove = move;
+
+			if (score > alpha) {
+				alpha = score;
+
+				pvTable[ply][ply] = move;
+				for (int next = ply + 1; next < pvLength[ply + 1]; ++next)
+					pvTable[ply][next] = pvTable[ply + 1][next];
+				pvLength[ply] = std::max(pvLength[ply + 1], ply + 1);
+
+				if (alpha >= beta) {
+					++cutoffs;
+					firstMoveCutoffs += legal == 1;
+					if (quiet)
+						_updateQuiet(move, depth, ply);
+					break;
+				}
+			}
+		}
+	}
+
+	if (!legal)
+		return inCheck ? -mateScore + ply : 0;
+
+	//With root moves left out, the score is not the one of the position
+	if (table && (ply || excludedRoot.empty())) {
+		auto bound = best >= beta ? Bound::Lower : best > originalAlpha ? Bound::Exact : Bound::Upper;
+		table->store(position.hash(), depth, bound,
+					 TTEntry::packSearch(bestMove, _scoreToTable(best, ply), 0));
+	}
+
+	return best;
+}
+
+void Search::_runHelper()
+{
+	//Every other helper stays a ply ahead of the main thread
+	for (int depth = 1 + helperIndex % 2; depth <= std::min(limits.depth, maxPly - 1); ++depth) {
+		iteration = depth;
+		followPv = true;
+		_negamax(depth, -infinity, infinity, 0);
+		if (stopped)	break;
+
+		previousPv.assign(pvTable[0].begin(), pvTable[0].begin() + pvLength[0]);
+	}
+}
+
+SearchResult Search::run(const GenericBoard& board, const SearchLimits& limits,
+						 const SearchCallback& onIteration, const std::vector<uint64_t>& gameHashes)
+{
+	ProfileDeclare;
+	this->limits = limits;
+	start = clock_t::now();
+
+	deadline = limits.time;
+	if (limits.clock.time) {
+		timeManager.start(limits.clock);
+		deadline = deadline ? std::min(deadline, timeManager.hardLimit()) : timeManager.hardLimit();
+	}
+	nodes = 0;
+	stopped = false;
+	previousPv.clear();
+	previousLines.clear();
+	excludedRoot.clear();
+	helpers.clear();
+	killers = {};
+	history = {};
+	cutoffs = 0;
+	firstMoveCutoffs = 0;
+	if (table)	table->newSearch();
+
+	SearchResult result;
+	position.useNetwork(network);
+	if (!position.load(board, gameHashes))	return result;
+
+	MoveList legal;
+	position.generateLegal(legal);
+	if (!legal.size())	return result;
+
+	//Whatever happens, there is a move to play
+	result.best = legal[0];
+	result.pv = { legal[0] };
+
+	//Helpers only help through the table, without one they would search alone
+	std::vector<std::thread> workers;
+	for (int idx = 1; table && idx < limits.threads; ++idx) {
+		helpers.push_back(std::make_unique<Search>(table));
+		auto& helper = *helpers.back();
+		helper.position = position;
+		helper.limits = limits;
+		helper.features = features;
+		helper.start = start;
+		helper.helperIndex = idx;
+		workers.emplace_back(&Search::_runHelper, &helper);
+	}
+
+	//Every line needs a root move of its own
+	auto lineCount = std::clamp<size_t>(limits.multiPv, 1, legal.size());
+
+	for (int depth = 1; depth <= std::min(limits.depth, maxPly - 1); ++depth) {
+		iteration = depth;
+
+		std::vector<PvLine> lines;
+		for (size_t line = 0; line < lineCount; ++line) {
+			//Every line follows its own variation from the last iteration
+			if (line < previousLines.size())
+				previousPv = previousLines[line].pv;
+			else
+				previousPv.clear();
+
+			followPv = true;
+			int score = _negamax(depth, -infinity, infinity, 0);
+
+			//An unfinished iteration is thrown away
+			if (stopped && (depth > 1 || !pvLength[0]))	break;
+
+			lines.push_back({ score, { pvTable[0].begin(), pvTable[0].begin() + pvLength[0] } });
+			excludedRoot.push_back(lines.back().pv.front());
+			if (stopped)	break;
+		}
+		excludedRoot.clear();
+
+		if (lines.empty() || (stopped && depth > 1))	break;
+
+		//A later line can come out better, when the table let an earlier one stop short
+		std::stable_sort(lines.begin(), lines.end(), [](const PvLine& first, const PvLine& second) {
+			return first.score > second.score;
+		});
+
+		int score = lines.front().score;
+		result.score = score;
+		result.depth = depth;
+		result.pv = lines.front().pv;
+		result.best = result.pv.front();
+		result.lines = lines;
+		previousLines = std::move(lines);
+		result.nodes = _totalNodes();
+		result.seconds = _elapsed();
+		result.cutoffs = cutoffs;
+		result.firstMoveCutoffs = firstMoveCutoffs;
+		result.pawnHitRate = pawnTable.hitRate();
+
+		if (onIteration)	onIteration(result);
+
+		if (stopped)	break;
+
+		//A mate was found, deeper iterations cannot find a shorter one
+		if (std::abs(score) >= mateScore - maxPly && mateScore - std::abs(score) <= depth)
+			break;
+
+		//The next iteration takes longer than all the previous ones together
+		if (limits.time && _elapsed() * 1000 * 2 >= limits.time)
+			break;
+
+		if (limits.clock.time && !timeManager.iterationDone(result.best, _elapsed() * 1000))
+			break;
+	}
+
+	for (auto& helper : helpers)
+		helper->stop();
+	for (auto& worker : workers)
+		worker.join();
+
+	//Helpers are done, so their counts are final
+	for (auto& helper : helpers)
+		helper->publishedNodes = helper->nodes;
+
+	result.nodes = _totalNodes();
+	result.seconds = _elapsed();
+	result.cutoffs = cutoffs;
+	result.firstMoveCutoffs = firstMoveCutoffs;
+	result.pawnHitRate = pawnTable.hitRate();
+	return result;
+}
+
+bool playMove(GenericBoard& board, const Move& move)
+{
+	ProfileDeclare;
+	if (move.isNone())	return false;
+
+	auto promotion = move.promotion;
+	return board.tryMove(toPosition(move.from), toPosition(move.to),
+						 [promotion](PieceType, const std::vector<PieceType>& choices) {
+		return std::find(choices.begin(), choices.end(), promotion) != choices.end()
+			? promotion : choices.front();
+	});
+}
+
+std::string scoreToString(int score)
+{
+	char formatted[32];
+	if (std::abs(score) >= Search::mateScore - Search::maxPly) {
+		int plies = Search::mateScore - std::abs(score);
+		int moves = (plies + 1) / 2;
+		snprintf(formatted, sizeof(formatted), "#%d", score > 0 ? moves : -moves);
+	}
+	else {
+		snprintf(formatted, sizeof(formatted), "%+.2f", score / 100.0);
+	}
+
+	return formatted;
+}
@@ -0,0 +1,50 @@
+#include "../../include/ai/timemanager.hpp"
+
+#include <algorithm>
+
+/*
+	Moves the rest of the game is expected to last, when it has to be
+	played without another time control.
+*/
+static constexpr int _expectedMoves = 30;
+
+void TimeManager::start(const GameClock& clock)
+{
+	lastBest = {};
+	stableIterations = 0;
+	instability = 0;
+
+	auto available = std::max<int64_t>(clock.time - clock.overhead, 1);
+	int moves = clock.movesToGo ? std::min(clock.movesToGo, 50) : _expectedMoves;
+
+	//Most of the increment comes back after the move, so most of it can be spent
+	soft = available / moves + clock.increment * 3 / 4;
+
+	//A single move can take a few times its share, but never the whole clock
+	hard = std::min(soft * 3, available - available / 10);
+	hard = std::max<int64_t>(hard, 1);
+	soft = std::min(soft, hard);
+}
+
+bool TimeManager::iterationDone(const Move& best, double elapsed)
+{
+	instability /= 2;
+	if (best == lastBest) {
+		++stableIterations;
+	}
+	else {
+		stableIterations = 0;
+		//The first iteration has no earlier best move to change from
+		if (!lastBest.isNone())
+			instability += 1;
+	}
+	lastBest = best;
+
+	double scale = 1 + instability;
+	if (stableIterations >= 4)
+		scale *= 0.6;
+	else if (stableIterations >= 2)
+		scale *= 0.8;
+
+	return elapsed < std::min(soft * scale, static_cast<double>(hard));
+}
@@ -0,0 +1,191 @@
+#include "../../include/ai/transposition.hpp"
+
+#include "../../include/profiler.hpp"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/*
+	Layout of the data word: depth in the lowest byte, then 6 bits
+	of generation, 2 bits of bound and 48 bits of payload.
+*/
+static constexpr int _generationShift = 8;
+static constexpr int _boundShift = 14;
+static constexpr int _payloadShift = 16;
+static constexpr uint8_t _generationMask = 63;
+
+inline uint64_t _pack(int depth, uint8_t generation, Bound bound, uint64_t payload) {
+	return static_cast<uint64_t>(depth & 0xFF)
+		| static_cast<uint64_t>(generation & _generationMask) << _generationShift
+		| static_cast<uint64_t>(bound) << _boundShift
+		| (payload & TTEntry::payloadMask) << _payloadShift;
+}
+
+inline int _depthOf(uint64_t data) {
+	return static_cast<int>(data & 0xFF);
+}
+
+inline uint8_t _generationOf(uint64_t data) {
+	return static_cast<uint8_t>(data >> _generationShift & _generationMask);
+}
+
+inline uint64_t _mulHigh(uint64_t a, uint64_t b) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	return __umulh(a, b);
+#elif defined(__SIZEOF_INT128__)
+	return static_cast<uint64_t>((static_cast<unsigned __int128>(a) * b) >> 64);
+#else
+	uint64_t aLow = a & 0xFFFFFFFF, aHigh = a >> 32;
+	uint64_t bLow = b & 0xFFFFFFFF, bHigh = b >> 32;
+	uint64_t middle = (aLow * bLow >> 32) + (aHigh * bLow & 0xFFFFFFFF) + aLow * bHigh;
+	return aHigh * bHigh + (aHigh * bLow >> 32) + (middle >> 32);
+#endif
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes)
+{
+	resize(megabytes);
+}
+
+TranspositionTable::Bucket& TranspositionTable::_bucket(uint64_t key) const
+{
+	//The high bits of the product pick the bucket, no modulo needed for any count
+	return buckets[static_cast<size_t>(_mulHigh(key, bucketCount))];
+}
+
+TranspositionTable::Counters& TranspositionTable::_counters()
+{
+	//Every thread keeps to one set of counters, picked in turn as threads first probe
+	static std::atomic<size_t> nextThread{ 0 };
+	thread_local size_t index = nextThread.fetch_add(1, std::memory_order_relaxed) % 16;
+	return counters[index];
+}
+
+void TranspositionTable::resize(size_t megabytes)
+{
+	ProfileDeclare;
+	bucketCount = std::max<size_t>(megabytes * 1024 * 1024 / sizeof(Bucket), 1);
+	buckets = std::make_unique<Bucket[]>(bucketCount);
+	clear();
+}
+
+void TranspositionTable::clear()
+{
+	ProfileDeclare;
+	for (size_t idx = 0; idx < bucketCount; ++idx) {
+		for (auto& slot : buckets[idx].slots) {
+			slot.check.store(0, std::memory_order_relaxed);
+			slot.data.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	for (auto& counter : counters) {
+		counter.probes.store(0, std::memory_order_relaxed);
+		counter.hits.store(0, std::memory_order_relaxed);
+	}
+
+	generation.store(0, std::memory_order_relaxed);
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry& entry)
+{
+	auto& counter = _counters();
+	counter.probes.fetch_add(1, std::memory_order_relaxed);
+
+	for (auto& slot : _bucket(key).slots) {
+		auto data = slot.data.load(std::memory_order_relaxed);
+		auto check = slot.check.load(std::memory_order_relaxed);
+
+		//Empty slots hold zeros, which would match a zero key
+		if (!data || (check ^ data) != key)	continue;
+
+		entry.depth = _depthOf(data);
+		entry.bound = static_cast<Bound>(data >> _boundShift & 3);
+		entry.payload = data >> _payloadShift;
+
+		counter.hits.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	return false;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, Bound bound, uint64_t payload)
+{
+	auto current = static_cast<uint8_t>(generation.load(std::memory_order_relaxed) & _generationMask);
+	auto& bucket = _bucket(key);
+
+	Slot* replace = nullptr;
+	int worst = 0;
+
+	for (auto& slot : bucket.slots) {
+		auto data = slot.data.load(std::memory_order_relaxed);
+		auto check = slot.check.load(std::memory_order_relaxed);
+
+		if (!data || (check ^ data) == key) {
+			replace = &slot;
+			break;
+		}
+
+		//Every search of age counts as much as eight plies of depth
+		int age = (current - _generationOf(data)) & _generationMask;
+		int value = _depthOf(data) - 8 * age;
+		if (!replace || value < worst) {
+			replace = &slot;
+			worst = value;
+		}
+	}
+
+	auto data = _pack(depth, current, bound, payload);
+	replace->data.store(data, std::memory_order_relaxed);
+	replace->check.store(key ^ data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::prefetch(uint64_t key) const
+{
+#if defined(_MSC_VER)
+	_mm_prefetch(reinterpret_cast<const char*>(&_bucket(key)), _MM_HINT_T0);
+#else
+	__builtin_prefetch(&_bucket(key));
+#endif
+}
+
+uint64_t TranspositionTable::probes() const
+{
+	uint64_t total = 0;
+	for (auto& counter : counters)
+		total += counter.probes.load(std::memory_order_relaxed);
+	return total;
+}
+
+uint64_t TranspositionTable::hits() const
+{
+	uint64_t total = 0;
+	for (auto& counter : counters)
+		total += counter.hits.load(std::memory_order_relaxed);
+	return total;
+}
+
+double TranspositionTable::hitRate() const
+{
+	auto all = probes();
+	return all ? static_cast<double>(hits()) / all : 0.0;
+}
+
+int TranspositionTable::permilleFull() const
+{
+	auto current = static_cast<uint8_t>(generation.load(std::memory_order_relaxed) & _generationMask);
+	int full = 0;
+	int sampled = 0;
+
+	for (size_t idx = 0; idx < bucketCount && sampled < 1000; ++idx) {
+		for (auto& slot : buckets[idx].slots) {
+			auto data = slot.data.load(std::memory_order_relaxed);
+			full += data && _generationOf(data) == current;
+			++sampled;
+		}
+	}
+
+	return sampled ? full * 1000 / sampled : 0;
+}
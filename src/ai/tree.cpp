@@ -0,0 +1,401 @@
+#include "../../include/ai/tree.hpp"
+#include "../../include/ai/evaluation.hpp"
+
+#include "../../include/profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <thread>
+
+NodePool::NodePool(size_t megabytes)
+{
+	resize(megabytes);
+}
+
+void NodePool::resize(size_t megabytes)
+{
+	ProfileDeclare;
+	size_t bytes = std::max<size_t>(megabytes, 1) * 1024 * 1024;
+
+	//A node with edges has a few dozen of them, but most nodes never get any
+	nodeCapacity = std::min<size_t>(bytes / 6 / sizeof(Node), noNode);
+	edgeCapacity = std::min<size_t>((bytes - nodeCapacity * sizeof(Node)) / sizeof(Edge), noNode);
+
+	nodes = std::make_unique<Node[]>(nodeCapacity);
+	edges = std::make_unique<Edge[]>(edgeCapacity);
+	clear();
+}
+
+uint32_t NodePool::allocateNode()
+{
+	auto index = nodeCount.fetch_add(1, std::memory_order_relaxed);
+	if (index >= nodeCapacity)	return noNode;
+
+	//The node may be left over from an earlier search
+	auto& node = nodes[index];
+	node.firstEdge = 0;
+	node.edgeCount = 0;
+	node.state.store(NodeState::Leaf, std::memory_order_relaxed);
+	node.visits.store(0, std::memory_order_relaxed);
+	node.value.store(0, std::memory_order_relaxed);
+	return static_cast<uint32_t>(index);
+}
+
+bool NodePool::allocateEdges(Node& node, const MoveList& moves)
+{
+	auto first = edgeCount.fetch_add(moves.size(), std::memory_order_relaxed);
+	if (first + moves.size() > edgeCapacity)	return false;
+
+	node.firstEdge = static_cast<uint32_t>(first);
+	node.edgeCount = static_cast<uint16_t>(moves.size());
+	for (auto& move : moves) {
+		edges[first].move = move;
+		edges[first++].child.store(noNode, std::memory_order_relaxed);
+	}
+
+	return true;
+}
+
+/*
+	Turns a score in centipawns from the view of the player to move
+	into the share of points that player can expect, from 0 to 1.
+*/
+inline double _expectedResult(int score) {
+	return 1 / (1 + std::pow(10.0, -score / 400.0));
+}
+
+double MonteCarloSearch::_elapsed() const
+{
+	return std::chrono::duration<double>(clock_t::now() - start).count();
+}
+
+bool MonteCarloSearch::_expand(Worker& worker, NodePool::Node& node)
+{
+	//Only one thread expands a node, the others look at it again and play out meanwhile
+	auto expected = NodePool::NodeState::Leaf;
+	if (!node.state.compare_exchange_strong(expected, NodePool::NodeState::Expanding, std::memory_order_acquire))
+		return true;
+
+	auto& position = worker.position;
+	MoveList moves;
+	position.generateLegal(moves);
+
+	if (!moves.size()) {
+		node.state.store(position.inCheck() ? NodePool::NodeState::Lost : NodePool::NodeState::Drawn,
+						 std::memory_order_release);
+		return true;
+	}
+
+	//Untried moves are tried in order, so captures of the most valuable pieces go first
+	std::stable_sort(moves.begin(), moves.end(), [&position](const Move& first, const Move& second) {
+		return pieceValue(pieceType(position.at(first.to))) > pieceValue(pieceType(position.at(second.to)));
+	});
+
+	if (!pool.allocateEdges(node, moves)) {
+		node.state.store(NodePool::NodeState::Leaf, std::memory_order_release);
+		return false;
+	}
+
+	node.state.store(NodePool::NodeState::Expanded, std::memory_order_release);
+	return true;
+}
+
+uint32_t MonteCarloSearch::_select(uint32_t index) const
+{
+	auto& node = pool.node(index);
+	double logVisits = std::log(std::max<double>(node.visits.load(std::memory_order_relaxed), 1));
+
+	uint32_t best = node.firstEdge;
+	double bestBound = -1;
+
+	for (uint32_t idx = node.firstEdge; idx < node.firstEdge + node.edgeCount; ++idx) {
+		auto& edge = pool.edge(idx);
+		auto childIndex = edge.child.load(std::memory_order_acquire);
+
+		//Every move is tried once before any is tried again
+		if (childIndex == NodePool::noNode)	return idx;
+
+		//Visits include the virtual losses of playouts still running, which pull the mean down
+		auto& child = pool.node(childIndex);
+		double visits = std::max<double>(child.visits.load(std::memory_order_relaxed), 1);
+		double value = child.value.load(std::memory_order_relaxed) / NodePool::valueScale;
+		double bound = value / visits + limits.exploration * std::sqrt(logVisits / visits);
+		if (bound > bestBound) {
+			bestBound = bound;
+			best = idx;
+		}
+	}
+
+	return best;
+}
+
+bool MonteCarloSearch::_playRollout(Worker& worker)
+{
+	auto& position = worker.position;
+	MoveList moves;
+	position.generate(moves);
+
+	//Indices of the moves not yet found illegal, picked from at random
+	std::array<uint8_t, 256> order;
+	size_t count = moves.size();
+	for (size_t idx = 0; idx < count; ++idx)
+		order[idx] = static_cast<uint8_t>(idx);
+
+	if (limits.rollout == Rollout::Heuristic) {
+		std::array<uint8_t, 256> captures;
+		size_t captureCount = 0;
+		for (size_t idx = 0; idx < count; ++idx) {
+			auto& move = moves[idx];
+			if ((position.at(move.to) || move.promotion == PieceType::Queen) && position.staticExchange(move) >= 0)
+				captures[captureCount++] = static_cast<uint8_t>(idx);
+		}
+
+		while (captureCount) {
+			auto picked = worker.random() % captureCount;
+			if (position.makeMove(moves[captures[picked]]))	return true;
+			captures[picked] = captures[--captureCount];
+		}
+	}
+
+	while (count) {
+		auto picked = worker.random() % count;
+		if (position.makeMove(moves[order[picked]]))	return true;
+		order[picked] = order[--count];
+	}
+
+	return false;
+}
+
+double MonteCarloSearch::_rollout(Worker& worker)
+{
+	auto& position = worker.position;
+	auto side = position.sideToMove();
+	int played = 0;
+	double result = -1;
+
+	for (; played < limits.rolloutPlies; ++played) {
+		if (position.halfmoveClock() >= 100 || position.isRepetition()) {
+			result = 0.5;
+			break;
+		}
+
+		if (!_playRollout(worker)) {
+			result = position.inCheck() ? 0 : 0.5;
+			break;
+		}
+	}
+
+	//The evaluation judges positions the rollout did not play to the end
+	if (result < 0)
+		result = _expectedResult(evaluate(position, -32767, 32767, &worker.pawnTable));
+
+	if (position.sideToMove() != side)
+		result = 1 - result;
+
+	for (; played > 0; --played)
+		position.unmakeMove();
+
+	return result;
+}
+
+void MonteCarloSearch::_playout(Worker& worker)
+{
+	auto& position = worker.position;
+	auto& path = worker.path;
+	auto virtualLoss = static_cast<uint32_t>(std::max(limits.virtualLoss, 1));
+
+	//Every node on the way counts as lost until the playout is done
+	auto _enter = [this, &path, virtualLoss](uint32_t index) {
+		path.push_back(index);
+		return pool.node(index).visits.fetch_add(virtualLoss, std::memory_order_relaxed) == 0;
+	};
+
+	path.clear();
+	uint32_t index = 0;
+	_enter(index);
+	bool firstVisit = false;
+	int played = 0;
+	double outcome;
+
+	//Walk down the tree to the first node no playout went through yet
+	while (true) {
+		auto& node = pool.node(index);
+		auto state = node.state.load(std::memory_order_acquire);
+
+		if (state == NodePool::NodeState::Lost) {
+			outcome = 0;
+			break;
+		}
+		if (state == NodePool::NodeState::Drawn) {
+			outcome = 0.5;
+			break;
+		}
+
+		//Edges are only generated on the second visit, most nodes are only visited once
+		if (state != NodePool::NodeState::Expanded) {
+			if (firstVisit || state == NodePool::NodeState::Expanding || !_expand(worker, node)) {
+				outcome = _rollout(worker);
+				break;
+			}
+			continue;
+		}
+
+		auto& edge = pool.edge(_select(index));
+		position.makeMove(edge.move);
+		++played;
+
+		auto child = edge.child.load(std::memory_order_acquire);
+		if (child == NodePool::noNode) {
+			child = pool.allocateNode();
+
+			//The pool is full, the tree stops growing here
+			if (child == NodePool::noNode) {
+				outcome = _rollout(worker);
+				break;
+			}
+
+			if (position.halfmoveClock() >= 100 || position.isRepetition())
+				pool.node(child).state.store(NodePool::NodeState::Drawn, std::memory_order_relaxed);
+
+			//Another thread may have tried the same move meanwhile, then its node
+			//is taken and this one is left unused
+			auto expected = NodePool::noNode;
+			if (!edge.child.compare_exchange_strong(expected, child, std::memory_order_release,
+													std::memory_order_acquire))
+				child = expected;
+		}
+
+		index = child;
+		firstVisit = _enter(index);
+	}
+
+	//The outcome is from the view of the player to move where the playout ended,
+	//every node takes it from the view of the player who moved into it
+	auto outcomeSide = position.sideToMove();
+	auto rootSide = root.sideToMove();
+	for (size_t depth = 0; depth < path.size(); ++depth) {
+		auto& node = pool.node(path[depth]);
+		auto mover = depth % 2 ? rootSide : opposite(rootSide);
+		auto result = mover == outcomeSide ? outcome : 1 - outcome;
+
+		node.value.fetch_add(static_cast<uint64_t>(result * NodePool::valueScale + 0.5), std::memory_order_relaxed);
+		if (virtualLoss > 1)
+			node.visits.fetch_sub(virtualLoss - 1, std::memory_order_relaxed);
+	}
+
+	for (; played > 0; --played)
+		position.unmakeMove();
+}
+
+void MonteCarloSearch::_runWorker(Worker& worker)
+{
+	while (!stopped) {
+		if (limits.playouts && startedPlayouts.fetch_add(1, std::memory_order_relaxed) >= limits.playouts)
+			break;
+
+		_playout(worker);
+		++worker.playouts;
+
+		if (limits.time && !(worker.playouts & 15) && _elapsed() * 1000 >= limits.time)
+			stopped = true;
+	}
+}
+
+MctsResult MonteCarloSearch::run(const GenericBoard& board, const MctsLimits& limits)
+{
+	ProfileDeclare;
+	this->limits = limits;
+	start = clock_t::now();
+	stopped = false;
+	startedPlayouts = 0;
+	pool.clear();
+
+	MctsResult result;
+	root.useNetwork(network);
+	if (!root.load(board))	return result;
+
+	MoveList legal;
+	root.generateLegal(legal);
+	if (!legal.size())	return result;
+
+	//Whatever happens, there is a move to play
+	result.best = legal[0];
+	result.pv = { legal[0] };
+
+	//The root is always the first node
+	pool.allocateNode();
+
+	int threads = std::max(limits.threads, 1);
+	std::vector<std::unique_ptr<Worker>> workers;
+	for (int idx = 0; idx < threads; ++idx) {
+		workers.push_back(std::make_unique<Worker>());
+		auto& worker = *workers.back();
+		worker.position = root;
+		worker.random.seed(seed + idx);
+		worker.path.reserve(256);
+	}
+
+	//The calling thread is the first worker
+	std::vector<std::thread> helpers;
+	for (int idx = 1; idx < threads; ++idx)
+		helpers.emplace_back(&MonteCarloSearch::_runWorker, this, std::ref(*workers[idx]));
+	_runWorker(*workers[0]);
+
+	stopped = true;
+	for (auto& helper : helpers)
+		helper.join();
+
+	for (auto& worker : workers) {
+		result.threadPlayouts.push_back(worker->playouts);
+		result.playouts += worker->playouts;
+	}
+
+	auto& rootNode = pool.node(0);
+	for (uint32_t idx = rootNode.firstEdge; idx < rootNode.firstEdge + rootNode.edgeCount; ++idx) {
+		auto& edge = pool.edge(idx);
+		MctsMove stats{ edge.move };
+		auto child = edge.child.load(std::memory_order_relaxed);
+		if (child != NodePool::noNode) {
+			stats.visits = pool.node(child).visits.load(std::memory_order_relaxed);
+			stats.winRate = pool.node(child).meanValue();
+		}
+		result.moves.push_back(stats);
+	}
+
+	std::stable_sort(result.moves.begin(), result.moves.end(), [](const MctsMove& first, const MctsMove& second) {
+		return first.visits > second.visits;
+	});
+
+	if (result.moves.size() && result.moves.front().visits) {
+		result.best = result.moves.front().move;
+		result.winRate = result.moves.front().winRate;
+	}
+
+	//The most visited child of every node on the way down
+	result.pv.clear();
+	for (uint32_t index = 0; pool.node(index).state.load() == NodePool::NodeState::Expanded;) {
+		auto& node = pool.node(index);
+		uint32_t best = NodePool::noNode;
+		uint32_t bestVisits = 0;
+		for (uint32_t idx = node.firstEdge; idx < node.firstEdge + node.edgeCount; ++idx) {
+			auto child = pool.edge(idx).child.load(std::memory_order_relaxed);
+			if (child == NodePool::noNode)	continue;
+
+			auto visits = pool.node(child).visits.load(std::memory_order_relaxed);
+			if (best == NodePool::noNode || visits > bestVisits) {
+				best = idx;
+				bestVisits = visits;
+			}
+		}
+
+		if (best == NodePool::noNode)	break;
+		result.pv.push_back(pool.edge(best).move);
+		index = pool.edge(best).child.load(std::memory_order_relaxed);
+	}
+
+	result.nodes = pool.nodesUsed();
+	result.memory = pool.memoryUsed();
+	result.seconds = _elapsed();
+	return result;
+}
@@ -0,0 +1,130 @@
+#include "../../include/bench/benchmark.hpp"
+
+#include "../../include/profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+
+using benchclock_t = std::chrono::steady_clock;
+
+inline long long _elapsedNs(benchclock_t::time_point since) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(benchclock_t::now() - since).count();
+}
+
+void BenchmarkRunner::add(Benchmark benchmark)
+{
+	benchmarks.push_back(std::move(benchmark));
+}
+
+std::vector<std::string> BenchmarkRunner::names() const
+{
+	std::vector<std::string> all;
+	for (auto& benchmark : benchmarks)
+		all.push_back(benchmark.name);
+	return all;
+}
+
+BenchmarkResult BenchmarkRunner::_measure(const Benchmark& benchmark) const
+{
+	ProfileDeclare;
+	for (size_t idx = 0; idx < warmup; ++idx) {
+		if (benchmark.setup)	benchmark.setup();
+		benchmark.run();
+	}
+
+	//Grow the batch until a single sample is long enough to time precisely
+	size_t batch = 1;
+	if (!benchmark.setup) {
+		while (batch < (1u << 24)) {
+			auto start = benchclock_t::now();
+			for (size_t idx = 0; idx < batch; ++idx)
+				benchmark.run();
+			if (_elapsedNs(start) >= minSampleNs)	break;
+			batch *= 2;
+		}
+	}
+
+	std::vector<double> perOp;
+	perOp.reserve(samples);
+
+	for (size_t sample = 0; sample < samples; ++sample) {
+		if (benchmark.setup)	benchmark.setup();
+
+		auto start = benchclock_t::now();
+		for (size_t idx = 0; idx < batch; ++idx)
+			benchmark.run();
+		perOp.push_back(static_cast<double>(_elapsedNs(start)) / batch);
+	}
+
+	std::sort(perOp.begin(), perOp.end());
+
+	BenchmarkResult result;
+	result.name = benchmark.name;
+	result.samples = perOp.size();
+	result.opsPerSample = batch;
+	result.mean = std::accumulate(perOp.begin(), perOp.end(), 0.0) / perOp.size();
+	result.median = perOp[perOp.size() / 2];
+	result.min = perOp.front();
+	result.max = perOp.back();
+
+	double variance = 0;
+	for (auto value : perOp)
+		variance += (value - result.mean) * (value - result.mean);
+	result.stddev = std::sqrt(variance / perOp.size());
+
+	return result;
+}
+
+std::vector<BenchmarkResult> BenchmarkRunner::run(const std::string& filter, std::ostream* progress) const
+{
+	ProfileDeclare;
+	std::vector<BenchmarkResult> results;
+
+	for (auto& benchmark : benchmarks) {
+		if (filter.size() && benchmark.name.find(filter) == std::string::npos)
+			continue;
+
+		results.push_back(_measure(benchmark));
+		if (progress)
+			*progress << formatResults({ results.back() }) << std::flush;
+	}
+
+	return results;
+}
+
+std::string formatResults(const std::vector<BenchmarkResult>& results)
+{
+	std::string table;
+	for (auto& result : results) {
+		char row[256];
+		snprintf(row, sizeof(row), "%-40s %12.1f ns %12.1f ns %12.1f ns %10.1f ns %8zu x %zu\n",
+				 result.name.c_str(), result.median, result.mean, result.min,
+				 result.stddev, result.samples, result.opsPerSample);
+		table += row;
+	}
+
+	return table;
+}
+
+std::string resultsToJSON(const std::vector<BenchmarkResult>& results)
+{
+	std::string json = "{\n\"benchmarks\": [";
+
+	for (size_t idx = 0; idx < results.size(); ++idx) {
+		auto& result = results[idx];
+		char values[320];
+		snprintf(values, sizeof(values), "\"samples\": %zu, \"ops_per_sample\": %zu, \"median_ns\": %.2f, "
+				 "\"mean_ns\": %.2f, \"min_ns\": %.2f, \"max_ns\": %.2f, \"stddev_ns\": %.2f",
+				 result.samples, result.opsPerSample, result.median, result.mean,
+				 result.min, result.max, result.stddev);
+
+		json += idx ? ",\n" : "\n";
+		json += "\t{ \"name\": \"" + result.name + "\", " + values + " }";
+	}
+
+	json += "\n]\n}\n";
+	return json;
+}
@@ -0,0 +1,547 @@
+/*
+	Microbenchmarks of the board hot paths, over a fixed set of positions.
+
+	Usage: bench [--list] [--filter TEXT] [--samples N] [--warmup N] [--json FILE]
+	       bench --selfplay GAMES [--threads N] [--seed S] [--json FILE]
+	       bench --sessions GAMES [--plies N] [--seed S]
+	       bench --perft DEPTH [--hash MB]
+	       bench --selective DEPTH [--games N] [--nodes N] [--threads N]
+	       bench --mcts PLAYOUTS [--random] [--threads N]
+
+	--list prints names of all benchmarks, --filter only runs those whose name
+	contains TEXT, --json also writes the results into FILE, - for stdout.
+	--selfplay plays GAMES random games on N threads instead, N defaults
+	to the number of cores. --sessions opens GAMES games in a SessionManager,
+	plays N random plies in every one of them and reports the memory they hold.
+	--perft counts the move tree of every position to DEPTH, once without
+	and once with a transposition table of MB megabytes, 64 by default.
+	--selective searches every position to DEPTH with all selective search
+	features and with each of them turned off, reporting the nodes each needs.
+	With --games, every feature then also plays a match of N games against
+	the full search at N nodes per move, 20000 by default, reporting the Elo
+	it is worth.
+	--mcts runs a Monte Carlo tree search of PLAYOUTS playouts on every
+	position on N threads sharing one tree and reports its speed and the
+	memory of its tree. --random plays random rollouts instead of ones that
+	prefer captures. It then runs the positions again on 1, 2, 4 and so on
+	up to N threads, reporting the playouts per second of every thread to
+	show how well the search scales.
+*/
+
+#include "../../include/ai/perft.hpp"
+#include "../../include/ai/transposition.hpp"
+#include "../../include/ai/tree.hpp"
+#include "../../include/ai/search.hpp"
+#include "../../include/bench/benchmark.hpp"
+#include "../../include/bench/match.hpp"
+#include "../../include/bench/selfplay.hpp"
+#include "../../include/boards/chess.hpp"
+#include "../../include/boards/sessions.hpp"
+#include "../../include/pieces/piecebuilder.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <thread>
+#include <string>
+#include <vector>
+#include <utility>
+
+/**
+	Chess board that exposes the internals measured by the benchmarks.
+*/
+class BenchBoard : public ChessBoard {
+public:
+	using ChessBoard::parseTurnToString;
+	using ChessBoard::_checkRepetition;
+};
+
+/*
+	Results are summed in here, so the compiler cannot drop the measured calls.
+*/
+volatile size_t benchSink = 0;
+
+/*
+	Add a result to the sink, without the compound assignment to a volatile C++20 deprecates.
+*/
+static void _keep(size_t value) {
+	benchSink = benchSink + value;
+}
+
+static const std::vector<std::pair<std::string, std::string>> benchPositions = {
+	{ "start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" },
+	{ "middlegame", "r1b1r1k1/1p1n1pbp/2q2np1/3Qp3/p1P1P3/2N1BN1P/PP3PP1/2K2B1R w - - 0 1" },
+	{ "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1" },
+	{ "endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1" },
+};
+
+/*
+	Openings the matches start from, a few moves into the most common ones.
+*/
+static const std::vector<std::string> matchOpenings = {
+	"r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+	"rnbqkbnr/ppp1pppp/8/3p4/2PP4/8/PP2PPPP/RNBQKBNR b KQkq c3 0 2",
+	"rnbqkbnr/pp2pppp/3p4/2p5/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 0 3",
+	"rnbqkbnr/ppp2ppp/4p3/3p4/3PP3/8/PPP2PPP/RNBQKBNR w KQkq d6 0 3",
+	"rnbqkbnr/pp2pppp/2p5/3p4/3PP3/8/PPP2PPP/RNBQKBNR w KQkq d6 0 3",
+	"rnbqkb1r/pppp1ppp/5n2/4p3/2P5/2N5/PP1PPPPP/R1BQKBNR w KQkq - 2 3",
+	"rnbqk2r/ppppppbp/5np1/8/2PP4/2N5/PP2PPPP/R1BQKBNR w KQkq - 2 4",
+	"r1bqk1nr/pppp1ppp/2n5/2b1p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+};
+
+static const std::vector<std::pair<PieceType, std::string>> benchPieceTypes = {
+	{ PieceType::Pawn, "pawn" },
+	{ PieceType::Knight, "knight" },
+	{ PieceType::Bishop, "bishop" },
+	{ PieceType::Rook, "rook" },
+	{ PieceType::Queen, "queen" },
+	{ PieceType::King, "king" },
+};
+
+/*
+	All legal moves of the side to play, in order of its piece list.
+*/
+std::vector<std::pair<Position, Position>> legalMoves(BenchBoard& board) {
+	std::vector<std::pair<Position, Position>> moves;
+	for (auto from : board.getPieces(board.getPlayingColor()))
+		for (auto to : board.getPossibleMoves(from))
+			moves.emplace_back(from, to);
+	return moves;
+}
+
+void registerPosition(BenchmarkRunner& runner, const std::string& name, const std::string& fen) {
+	auto board = std::make_shared<BenchBoard>();
+	if (!board->loadFEN(fen)) {
+		std::cerr << "Could not load position " << name << ", skipping it.\n";
+		return;
+	}
+
+	for (auto& [type, typeName] : benchPieceTypes) {
+		std::vector<Position> ofType;
+		for (auto color : { Color::White, Color::Black })
+			for (auto pos : board->getPieces(color))
+				if (board->getPiece(pos)->getType() == type)
+					ofType.push_back(pos);
+
+		if (!ofType.size())	continue;
+
+		runner.add({ "getAllAvailableMoves/" + typeName + "/" + name, [board, ofType] {
+			for (auto pos : ofType)
+				_keep(board->getPiece(pos)->getAllAvailableMoves(pos, board->getState()).size());
+		} });
+	}
+
+	runner.add({ "getPossibleMoves/" + name, [board] {
+		for (auto pos : board->getPieces(board->getPlayingColor()))
+			_keep(board->getPossibleMoves(pos).size());
+	} });
+
+	runner.add({ "recalculateThreat/" + name, [board] {
+		board->recalculateThreat();
+	} });
+
+	runner.add({ "checkRepetition/" + name, [board] {
+		_keep(board->_checkRepetition());
+	} });
+
+	auto moves = legalMoves(*board);
+	if (!moves.size())	return;
+
+	auto [from, to] = moves.front();
+	auto fromPiece = board->getPiece(from);
+	auto toPiece = board->getPiece(to);
+	auto threats = board->getPieceStorage(to).threat;
+
+	runner.add({ "parseTurnToString/" + name, [=] {
+		_keep(board->parseTurnToString(from, fromPiece->getType(), fromPiece->getColor(),
+									   to, toPiece->getType(), toPiece->getColor(),
+									   PieceType::None, threats).size());
+	} });
+
+	//Every move is played on a fresh copy, going through all legal moves in turn
+	auto work = std::make_shared<std::optional<BenchBoard>>();
+	auto next = std::make_shared<size_t>(0);
+
+	runner.add({ "tryMove/" + name, [work, moves, next] {
+		auto [from, to] = moves[(*next)++ % moves.size()];
+		_keep((*work)->tryMove(from, to));
+	}, [board, work] {
+		work->emplace(*board);
+	} });
+}
+
+/*
+	Opens the games, plays them for a while and reports their memory,
+	all games are open at the same time.
+*/
+void sessionReport(size_t games, size_t plies, uint32_t seed) {
+	using benchclock_t = std::chrono::steady_clock;
+	auto _seconds = [](benchclock_t::time_point since) {
+		return std::chrono::duration<double>(benchclock_t::now() - since).count();
+	};
+
+	SessionManager manager;
+	std::mt19937 gen(seed);
+	using Dist = std::uniform_int_distribution<size_t>;
+	auto promote = [&gen](PieceType, const std::vector<PieceType>& choices) {
+		return choices[Dist{ 0, choices.size() - 1 }(gen)];
+	};
+
+	auto start = benchclock_t::now();
+	std::vector<session_id_t> ids;
+	for (size_t idx = 0; idx < games; ++idx)
+		ids.push_back(manager.create(BoardType::Chess));
+	double created = _seconds(start);
+
+	auto fresh = manager.memoryUsage();
+
+	start = benchclock_t::now();
+	std::vector<std::pair<Position, Position>> moves;
+	for (auto id : ids) {
+		manager.with(id, [&](GenericBoard& board) {
+			for (size_t ply = 0; ply < plies && board.getWinner() == Color::None; ++ply) {
+				moves.clear();
+				for (auto from : board.getPieces(board.getPlayingColor()))
+					for (auto to : board.getPossibleMoves(from))
+						moves.emplace_back(from, to);
+
+				if (!moves.size())	break;
+				auto [from, to] = moves[Dist{ 0, moves.size() - 1 }(gen)];
+				board.tryMove(from, to, promote);
+			}
+		});
+	}
+	double played = _seconds(start);
+
+	auto used = manager.memoryUsage();
+
+	start = benchclock_t::now();
+	for (auto id : ids)
+		manager.close(id);
+	double closed = _seconds(start);
+
+	char report[512];
+	snprintf(report, sizeof(report),
+			 "Opened %zu games in %.3fs, %.0f bytes per new game.\n"
+			 "Played %zu plies in every game in %.3fs, %.0f bytes per game after.\n"
+			 "Closed all games in %.3fs, %zu bytes of bookkeeping per game.\n",
+			 games, created, games ? static_cast<double>(fresh) / games : 0.0,
+			 plies, played, games ? static_cast<double>(used) / games : 0.0,
+			 closed, SessionManager::sessionOverhead());
+	std::cout << report;
+}
+
+/*
+	Counts the move tree of every position, with and without a transposition table.
+*/
+void perftReport(int depth, size_t megabytes) {
+	using benchclock_t = std::chrono::steady_clock;
+	auto _seconds = [](benchclock_t::time_point since) {
+		return std::chrono::duration<double>(benchclock_t::now() - since).count();
+	};
+
+	TranspositionTable table(megabytes);
+
+	char line[256];
+	snprintf(line, sizeof(line), "%-12s %12s %10s %10s %9s %7s\n",
+			 "Position", "Nodes", "Plain", "Hashed", "Hit rate", "Full");
+	std::cout << line;
+
+	for (auto& [name, fen] : benchPositions) {
+		auto board = std::make_shared<ChessBoard>();
+		SearchPosition position;
+		if (!board->loadFEN(fen) || !position.load(*board)) {
+			std::cerr << "Could not load position " << name << ", skipping it.\n";
+			continue;
+		}
+
+		auto start = benchclock_t::now();
+		auto nodes = perft(position, depth);
+		double plain = _seconds(start);
+
+		table.clear();
+		start = benchclock_t::now();
+		auto hashedNodes = perft(position, depth, &table);
+		double hashed = _seconds(start);
+
+		snprintf(line, sizeof(line), "%-12s %12llu %9.3fs %9.3fs %8.1f%% %6.1f%%%s\n",
+				 name.c_str(), static_cast<unsigned long long>(nodes), plain, hashed,
+				 table.hitRate() * 100, table.permilleFull() / 10.0,
+				 nodes == hashedNodes ? "" : "  counts differ!");
+		std::cout << line;
+	}
+}
+
+/*
+	Measures what every selective search feature saves in nodes at a fixed
+	depth and, with games, what it is worth in a match at fixed nodes.
+*/
+void selectiveReport(int depth, size_t games, uint64_t nodes, int threads) {
+	std::vector<std::pair<std::string, SearchFeatures>> variants = { { "all", SearchFeatures{} } };
+	auto _without = [&variants](const char* name, bool SearchFeatures::* feature) {
+		SearchFeatures features;
+		features.*feature = false;
+		variants.emplace_back(name, features);
+	};
+	_without("no null move", &SearchFeatures::nullMove);
+	_without("no reductions", &SearchFeatures::lateMoveReductions);
+	_without("no futility", &SearchFeatures::futility);
+	_without("no razoring", &SearchFeatures::razoring);
+	_without("no extensions", &SearchFeatures::checkExtensions);
+	variants.emplace_back("none", SearchFeatures{ false, false, false, false, false });
+
+	char line[256];
+	snprintf(line, sizeof(line), "%-14s %12s %10s %9s\n", "Search", "Nodes", "Time", "vs all");
+	std::cout << line;
+
+	TranspositionTable table(16);
+	uint64_t allNodes = 0;
+
+	for (auto& [name, features] : variants) {
+		uint64_t total = 0;
+		double seconds = 0;
+
+		for (auto& [positionName, fen] : benchPositions) {
+			ChessBoard board;
+			if (!board.loadFEN(fen))	continue;
+
+			table.clear();
+			Search search(&table);
+			search.useFeatures(features);
+			SearchLimits limits;
+			limits.depth = depth;
+			auto result = search.run(board, limits);
+			total += result.nodes;
+			seconds += result.seconds;
+		}
+
+		if (!allNodes)	allNodes = total;
+		snprintf(line, sizeof(line), "%-14s %12llu %9.3fs %8.2fx\n", name.c_str(),
+				 static_cast<unsigned long long>(total), seconds,
+				 allNodes ? static_cast<double>(total) / allNodes : 0.0);
+		std::cout << line;
+	}
+
+	if (!games)	return;
+
+	std::cout << "\nMatches of the full search against every variant, " << nodes
+		<< " nodes per move, Elo of the full search:\n";
+	for (size_t idx = 1; idx < variants.size(); ++idx) {
+		auto result = playMatch(variants[0].second, variants[idx].second, matchOpenings, games, nodes, threads);
+		snprintf(line, sizeof(line), "%-14s ", variants[idx].first.c_str());
+		std::cout << line << formatMatch(result) << std::endl;
+	}
+}
+
+/*
+	Runs a Monte Carlo tree search on every position, reporting its speed and memory,
+	then how its speed scales with the number of threads.
+*/
+void mctsReport(uint64_t playouts, Rollout rollout, int threads) {
+	char line[256];
+	snprintf(line, sizeof(line), "%-12s %10s %12s %10s %10s %9s  %s\n",
+			 "Position", "Playouts", "Playouts/s", "Nodes", "Memory", "Win", "Best");
+	std::cout << line;
+
+	MonteCarloSearch search(256);
+	MctsLimits limits;
+	limits.playouts = playouts;
+	limits.rollout = rollout;
+	limits.threads = threads;
+
+	for (auto& [name, fen] : benchPositions) {
+		ChessBoard board;
+		if (!board.loadFEN(fen)) {
+			std::cerr << "Could not load position " << name << ", skipping it.\n";
+			continue;
+		}
+
+		auto result = search.run(board, limits);
+
+		snprintf(line, sizeof(line), "%-12s %10llu %12.0f %10zu %8zuKB %8.1f%%  %s\n", name.c_str(),
+				 static_cast<unsigned long long>(result.playouts), result.playoutsPerSecond(),
+				 result.nodes, result.memory / 1024, result.winRate * 100, result.best.toString().c_str());
+		std::cout << line;
+	}
+
+	//Perfect scaling keeps the playouts per second of every thread the same
+	std::cout << "\n";
+	snprintf(line, sizeof(line), "%-8s %12s %16s %11s\n", "Threads", "Playouts/s", "Per thread", "Efficiency");
+	std::cout << line;
+
+	std::vector<int> counts;
+	for (int count = 1; count < threads; count *= 2)
+		counts.push_back(count);
+	counts.push_back(threads);
+
+	double singleThread = 0;
+	for (int count : counts) {
+		limits.threads = count;
+		uint64_t total = 0;
+		double seconds = 0;
+		for (auto& [name, fen] : benchPositions) {
+			ChessBoard board;
+			if (!board.loadFEN(fen))	continue;
+
+			auto result = search.run(board, limits);
+			total += result.playouts;
+			seconds += result.seconds;
+		}
+
+		double perSecond = seconds > 0 ? total / seconds : 0;
+		double perThread = perSecond / count;
+		if (count == 1)
+			singleThread = perThread;
+
+		snprintf(line, sizeof(line), "%-8d %12.0f %16.0f %10.1f%%\n", count, perSecond, perThread,
+				 singleThread > 0 ? perThread / singleThread * 100 : 0);
+		std::cout << line;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string filter;
+	std::string jsonFile;
+	bool list = false;
+	size_t selfPlayGames = 0;
+	size_t sessionGames = 0;
+	size_t sessionPlies = 10;
+	int perftDepth = 0;
+	int selectiveDepth = 0;
+	size_t matchGames = 0;
+	uint64_t matchNodes = 20000;
+	uint64_t mctsPlayouts = 0;
+	auto rollout = Rollout::Heuristic;
+	size_t hashSize = 64;
+	int threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+	uint32_t seed = 1;
+
+	BenchmarkRunner runner;
+
+	for (int idx = 1; idx < argc; ++idx) {
+		std::string arg = argv[idx];
+		bool hasValue = idx + 1 < argc;
+
+		if (arg == "--list")
+			list = true;
+		else if (arg == "--filter" && hasValue)
+			filter = argv[++idx];
+		else if (arg == "--json" && hasValue)
+			jsonFile = argv[++idx];
+		else if (arg == "--samples" && hasValue)
+			runner.sampleCount(std::stoul(argv[++idx]));
+		else if (arg == "--warmup" && hasValue)
+			runner.warmupIterations(std::stoul(argv[++idx]));
+		else if (arg == "--selfplay" && hasValue)
+			selfPlayGames = std::stoul(argv[++idx]);
+		else if (arg == "--sessions" && hasValue)
+			sessionGames = std::stoul(argv[++idx]);
+		else if (arg == "--plies" && hasValue)
+			sessionPlies = std::stoul(argv[++idx]);
+		else if (arg == "--perft" && hasValue)
+			perftDepth = std::stoi(argv[++idx]);
+		else if (arg == "--selective" && hasValue)
+			selectiveDepth = std::stoi(argv[++idx]);
+		else if (arg == "--games" && hasValue)
+			matchGames = std::stoul(argv[++idx]);
+		else if (arg == "--nodes" && hasValue)
+			matchNodes = std::stoull(argv[++idx]);
+		else if (arg == "--mcts" && hasValue)
+			mctsPlayouts = std::stoull(argv[++idx]);
+		else if (arg == "--random")
+			rollout = Rollout::Random;
+		else if (arg == "--hash" && hasValue)
+			hashSize = std::stoul(argv[++idx]);
+		else if (arg == "--threads" && hasValue)
+			threads = std::stoi(argv[++idx]);
+		else if (arg == "--seed" && hasValue)
+			seed = static_cast<uint32_t>(std::stoul(argv[++idx]));
+		else {
+			std::cerr << "Usage: " << argv[0]
+				<< " [--list] [--filter TEXT] [--samples N] [--warmup N] [--json FILE]\n"
+				<< "       " << argv[0] << " --selfplay GAMES [--threads N] [--seed S] [--json FILE]\n"
+				<< "       " << argv[0] << " --sessions GAMES [--plies N] [--seed S]\n"
+				<< "       " << argv[0] << " --perft DEPTH [--hash MB]\n"
+				<< "       " << argv[0] << " --selective DEPTH [--games N] [--nodes N] [--threads N]\n"
+				<< "       " << argv[0] << " --mcts PLAYOUTS [--random] [--threads N]\n";
+			return 1;
+		}
+	}
+
+	if (perftDepth > 0) {
+		perftReport(perftDepth, hashSize);
+		return 0;
+	}
+
+	if (mctsPlayouts) {
+		mctsReport(mctsPlayouts, rollout, std::max(threads, 1));
+		return 0;
+	}
+
+	if (selectiveDepth > 0) {
+		selectiveReport(selectiveDepth, matchGames, matchNodes, threads);
+		return 0;
+	}
+
+	if (sessionGames) {
+		sessionReport(sessionGames, sessionPlies, seed);
+		return 0;
+	}
+
+	if (selfPlayGames) {
+		auto result = runSelfPlay(selfPlayGames, threads, seed);
+		bool jsonToStdout = jsonFile == "-";
+		(jsonToStdout ? std::cerr : std::cout) << formatSelfPlay(result);
+
+		if (jsonToStdout) {
+			std::cout << selfPlayToJSON(result);
+		}
+		else if (jsonFile.size()) {
+			std::ofstream out{ jsonFile };
+			out << selfPlayToJSON(result);
+		}
+
+		return 0;
+	}
+
+	for (auto& [name, fen] : benchPositions)
+		registerPosition(runner, name, fen);
+
+	auto next = std::make_shared<size_t>(0);
+	runner.add({ "newPieceByType", [next] {
+		auto type = static_cast<PieceType>(*next % static_cast<size_t>(PieceType::None));
+		auto color = (*next)++ & 1 ? Color::White : Color::Black;
+		_keep(newPieceByType(type, color) != nullptr);
+	} });
+
+	if (list) {
+		for (auto& name : runner.names())
+			std::cout << name << "\n";
+		return 0;
+	}
+
+	//Progress goes to stderr when the JSON is printed, so stdout stays valid JSON
+	bool jsonToStdout = jsonFile == "-";
+	auto& progress = jsonToStdout ? std::cerr : std::cout;
+
+	char header[256];
+	snprintf(header, sizeof(header), "%-40s %15s %15s %15s %13s %s\n",
+			 "Benchmark", "Median", "Mean", "Min", "Stddev", "Samples");
+	progress << header;
+
+	auto results = runner.run(filter, &progress);
+
+	if (jsonToStdout) {
+		std::cout << resultsToJSON(results);
+	}
+	else if (jsonFile.size()) {
+		std::ofstream out{ jsonFile };
+		out << resultsToJSON(results);
+		progress << "Wrote results into " << jsonFile << "\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,153 @@
+#include "../../include/bench/match.hpp"
+#include "../../include/ai/transposition.hpp"
+#include "../../include/boards/chess.hpp"
+
+#include "../../include/profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+/*
+	Elo difference of a share of points, clamped so that a perfect
+	score does not come out infinite.
+*/
+static double _elo(double score)
+{
+	score = std::clamp(score, 0.001, 0.999);
+	return -400 * std::log10(1 / score - 1);
+}
+
+double MatchResult::eloDifference() const
+{
+	return _elo(score());
+}
+
+double MatchResult::eloMargin() const
+{
+	if (!games)	return 0;
+
+	//Spread of the points of a single game around the mean score
+	double mean = score();
+	double variance = (wins * std::pow(1 - mean, 2) + draws * std::pow(0.5 - mean, 2)
+					   + losses * std::pow(mean, 2)) / games;
+	double deviation = std::sqrt(variance / games);
+
+	return (_elo(mean + 1.96 * deviation) - _elo(mean - 1.96 * deviation)) / 2;
+}
+
+/*
+	Plays every threads-th game starting with the first one,
+	adding the outcomes into result.
+*/
+static void _playGames(size_t first, size_t games, int threads, const SearchFeatures& firstFeatures,
+					   const SearchFeatures& secondFeatures, const std::vector<std::string>& openings,
+					   uint64_t nodes, size_t maxPlies, MatchResult& result)
+{
+	ProfileDeclare;
+	std::array<std::unique_ptr<TranspositionTable>, 2> tables;
+	std::array<std::unique_ptr<Search>, 2> engines;
+	for (int idx = 0; idx < 2; ++idx) {
+		tables[idx] = std::make_unique<TranspositionTable>(16);
+		engines[idx] = std::make_unique<Search>(tables[idx].get());
+	}
+	engines[0]->useFeatures(firstFeatures);
+	engines[1]->useFeatures(secondFeatures);
+
+	SearchLimits limits;
+	limits.nodes = nodes;
+
+	ChessBoard board;
+	SearchPosition position;
+	std::vector<uint64_t> gameHashes;
+	for (size_t game = first; game < games; game += threads) {
+		if (!board.loadFEN(openings[game / 2 % openings.size()]) || !position.load(board))
+			continue;
+		gameHashes.clear();
+
+		//Every game starts from nothing, so a game does not depend on the one before
+		for (auto& table : tables)
+			table->clear();
+
+		//In every pair of games the first engine plays either color once
+		auto firstColor = board.getPlayingColor();
+		if (game % 2)
+			firstColor = firstColor == Color::White ? Color::Black : Color::White;
+
+		size_t plies = 0;
+		while (board.getWinner() == Color::None && plies < maxPlies) {
+			auto& engine = *engines[board.getPlayingColor() == firstColor ? 0 : 1];
+			auto found = engine.run(board, limits, nullptr, gameHashes);
+			if (!playMove(board, found.best))	break;
+
+			//The board draws on repetitions, so the engines have to see the positions before their root
+			gameHashes.push_back(position.hash());
+			position.makeMove(found.best);
+			++plies;
+		}
+
+		result.games++;
+		result.plies += plies;
+
+		auto winner = board.getWinner();
+		if (winner == firstColor)
+			result.wins++;
+		else if (winner == Color::White || winner == Color::Black)
+			result.losses++;
+		else
+			result.draws++;
+
+		if (winner == Color::None)
+			result.unfinished++;
+	}
+}
+
+MatchResult playMatch(const SearchFeatures& first, const SearchFeatures& second,
+					  const std::vector<std::string>& openings, size_t games,
+					  uint64_t nodes, int threads, size_t maxPlies)
+{
+	ProfileDeclare;
+	threads = std::max(threads, 1);
+
+	MatchResult total;
+	total.threads = threads;
+	if (openings.empty())	return total;
+
+	std::vector<MatchResult> partial(threads);
+	std::vector<std::thread> workers;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (int idx = 0; idx < threads; ++idx)
+		workers.emplace_back(_playGames, idx, games, threads, std::cref(first), std::cref(second),
+							 std::cref(openings), nodes, maxPlies, std::ref(partial[idx]));
+
+	for (auto& worker : workers)
+		worker.join();
+
+	total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	for (auto& part : partial) {
+		total.games += part.games;
+		total.wins += part.wins;
+		total.draws += part.draws;
+		total.losses += part.losses;
+		total.unfinished += part.unfinished;
+		total.plies += part.plies;
+	}
+
+	return total;
+}
+
+std::string formatMatch(const MatchResult& result)
+{
+	char report[256];
+	snprintf(report, sizeof(report), "+%zu =%zu -%zu of %zu games, %.1f%%, Elo %+.0f +- %.0f, %zu unfinished, %.1fs",
+			 result.wins, result.draws, result.losses, result.games, result.score() * 100,
+			 result.eloDifference(), result.eloMargin(), result.unfinished, result.seconds);
+	return report;
+}
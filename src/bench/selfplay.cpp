@@ -0,0 +1,145 @@
+#include "../../include/bench/selfplay.hpp"
+#include "../../include/boards/chess.hpp"
+
+#include "../../include/profiler.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std::string_literals;
+
+/*
+	Plays every threads-th game starting with the first one,
+	adding the outcomes into result.
+*/
+void _playGames(size_t first, size_t games, int threads, uint32_t seed,
+				size_t maxPlies, SelfPlayResult& result) {
+	ProfileDeclare;
+	ChessBoard board;
+	std::vector<std::pair<Position, Position>> moves;
+
+	for (size_t game = first; game < games; game += threads) {
+		std::mt19937 gen(seed + static_cast<uint32_t>(game));
+		using Dist = std::uniform_int_distribution<size_t>;
+
+		auto promote = [&gen](PieceType, const std::vector<PieceType>& choices) {
+			return choices[Dist{ 0, choices.size() - 1 }(gen)];
+		};
+
+		board.initialize();
+		size_t plies = 0;
+
+		while (board.getWinner() == Color::None && plies < maxPlies) {
+			moves.clear();
+			for (auto from : board.getPieces(board.getPlayingColor()))
+				for (auto to : board.getPossibleMoves(from))
+					moves.emplace_back(from, to);
+
+			//Cannot happen while the game runs, stalemate ends it first
+			if (!moves.size())	break;
+
+			auto [from, to] = moves[Dist{ 0, moves.size() - 1 }(gen)];
+			if (!board.tryMove(from, to, promote))	break;
+			++plies;
+		}
+
+		result.games++;
+		result.plies += plies;
+
+		switch (board.getWinner()) {
+		case Color::White:
+			result.whiteWins++;
+			break;
+		case Color::Black:
+			result.blackWins++;
+			break;
+		case Color::Pat:
+			result.draws++;
+			break;
+		default:
+			result.unfinished++;
+			break;
+		}
+
+		result.ends[static_cast<size_t>(board.getGameEnd())]++;
+	}
+}
+
+SelfPlayResult runSelfPlay(size_t games, int threads, uint32_t seed, size_t maxPlies)
+{
+	ProfileDeclare;
+	threads = std::max(threads, 1);
+
+	std::vector<SelfPlayResult> partial(threads);
+	std::vector<std::thread> workers;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (int idx = 0; idx < threads; ++idx)
+		workers.emplace_back(_playGames, idx, games, threads, seed, maxPlies, std::ref(partial[idx]));
+
+	for (auto& worker : workers)
+		worker.join();
+
+	SelfPlayResult total;
+	total.threads = threads;
+	total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	for (auto& part : partial) {
+		total.games += part.games;
+		total.plies += part.plies;
+		total.unfinished += part.unfinished;
+		total.whiteWins += part.whiteWins;
+		total.blackWins += part.blackWins;
+		total.draws += part.draws;
+		for (size_t idx = 0; idx < total.ends.size(); ++idx)
+			total.ends[idx] += part.ends[idx];
+	}
+
+	return total;
+}
+
+static const char* _endNames[SelfPlayResult::endCount] = {
+	"unfinished", "checkmate", "stalemate", "fifty_moves", "repetition", "forfeit"
+};
+
+std::string formatSelfPlay(const SelfPlayResult& result)
+{
+	char report[1024];
+	int written = snprintf(report, sizeof(report),
+						   "Played %zu games, %zu plies on %d threads in %.3fs.\n"
+						   "%.2f games/s, %.0f plies/s, %.1f plies per game.\n"
+						   "White won %zu, black won %zu, %zu draws, %zu unfinished.\n",
+						   result.games, result.plies, result.threads, result.seconds,
+						   result.gamesPerSecond(), result.pliesPerSecond(),
+						   result.games ? static_cast<double>(result.plies) / result.games : 0.0,
+						   result.whiteWins, result.blackWins, result.draws, result.unfinished);
+
+	std::string formatted{ report, static_cast<size_t>(std::max(written, 0)) };
+	formatted += "Ended by:";
+	for (size_t idx = 1; idx < result.ends.size(); ++idx)
+		formatted += " "s + _endNames[idx] + " " + std::to_string(result.ends[idx]) + (idx + 1 < result.ends.size() ? "," : ".\n");
+
+	return formatted;
+}
+
+std::string selfPlayToJSON(const SelfPlayResult& result)
+{
+	char values[512];
+	snprintf(values, sizeof(values), "\"games\": %zu, \"plies\": %zu, \"threads\": %d, \"seconds\": %.6f, "
+			 "\"games_per_second\": %.3f, \"plies_per_second\": %.3f, "
+			 "\"white_wins\": %zu, \"black_wins\": %zu, \"draws\": %zu, \"unfinished\": %zu",
+			 result.games, result.plies, result.threads, result.seconds,
+			 result.gamesPerSecond(), result.pliesPerSecond(),
+			 result.whiteWins, result.blackWins, result.draws, result.unfinished);
+
+	std::string json = "{\n\"selfplay\": { "s + values + ", \"ends\": {";
+	for (size_t idx = 1; idx < result.ends.size(); ++idx)
+		json += (idx > 1 ? ", \""s : " \""s) + _endNames[idx] + "\": " + std::to_string(result.ends[idx]);
+	json += " } }\n}\n";
+
+	return json;
+}
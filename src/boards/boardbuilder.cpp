@@ -5,18 +5,12 @@
 
 #include "../../include/profiler.hpp"
 
-template <class T>
-std::shared_ptr<GenericBoard> _getBoard() {
-	static std::shared_ptr<T> board = std::make_shared<T>();
-	return board;
-}
-
-std::shared_ptr<GenericBoard> getBoard(BoardType type)
+std::shared_ptr<GenericBoard> newBoard(BoardType type)
 {
 	ProfileDeclare;
 	switch (type) {
 	case BoardType::Chess:
-		return _getBoard<ChessBoard>();
+		return std::make_shared<ChessBoard>();
 	}
 	return nullptr;
 }
@@ -3,6 +3,11 @@
 #include "../../include/pieces/generic.hpp"
 
 #include "../../include/profiler.hpp"
+#include "../../include/stringutil.hpp"
+#include "../../include/ui/conactions.hpp"
+
+#include <cctype>
+#include <charconv>
 
 void ChessBoard::initialize()
 {
@@ -26,38 +31,6 @@ void ChessBoard::initialize()
 		PieceType::Rook
 	};
 
-	addPiece("c1", PieceType::King, Color::White);
-	addPiece("a2", PieceType::Pawn, Color::White);
-	addPiece("b2", PieceType::Pawn, Color::White);
-	addPiece("c3", PieceType::Knight, Color::White);
-	addPiece("c4", PieceType::Pawn, Color::White);
-	addPiece("d5", PieceType::Queen, Color::White);
-	addPiece("e3", PieceType::Bishop, Color::White);
-	addPiece("e4", PieceType::Pawn, Color::White);
-	addPiece("f1", PieceType::Bishop, Color::White);
-	addPiece("f2", PieceType::Pawn, Color::White);
-	addPiece("f3", PieceType::Knight, Color::White);
-	addPiece("g2", PieceType::Pawn, Color::White);
-	addPiece("h1", PieceType::Rook, Color::White);
-	addPiece("h3", PieceType::Pawn, Color::White);
-
-	addPiece("g8", PieceType::King, Color::Black);
-	addPiece("a8", PieceType::Rook, Color::Black);
-	addPiece("a4", PieceType::Pawn, Color::Black);
-	addPiece("b7", PieceType::Pawn, Color::Black);
-	addPiece("c8", PieceType::Bishop, Color::Black);
-	addPiece("c6", PieceType::Queen, Color::Black);
-	addPiece("d7", PieceType::Knight, Color::Black);
-	addPiece("e8", PieceType::Rook, Color::Black);
-	addPiece("e5", PieceType::Pawn, Color::Black);
-	addPiece("f7", PieceType::Pawn, Color::Black);
-	addPiece("f6", PieceType::Knight, Color::Black);
-	addPiece("g7", PieceType::Bishop, Color::Black);
-	addPiece("g6", PieceType::Pawn, Color::Black);
-	addPiece("h7", PieceType::Pawn, Color::Black);
-
-
-	/*
 	for (int i = 0; i < state.width; ++i) {
 		//Distribute pawns
 		addPiece({ 1, i }, PieceType::Pawn, Color::White);
@@ -67,7 +40,6 @@ void ChessBoard::initialize()
 		addPiece({ 0, i }, typeArray[i], Color::White);
 		addPiece({ 7, i }, typeArray[i], Color::Black);
 	}
-	//*/
 
 	/*
 	addPiece("c8", PieceType::King, Color::Black);
@@ -143,3 +115,90 @@ void ChessBoard::initialize()
 	
 	GenericBoard::initialize();
 }
+
+std::shared_ptr<GenericBoard> ChessBoard::clone() const
+{
+	ProfileDeclare;
+	return std::make_shared<ChessBoard>(*this);
+}
+
+bool ChessBoard::loadFEN(std::string_view fen)
+{
+	ProfileDeclare;
+	auto fail = [this] {
+		initialize();
+		return false;
+	};
+
+	auto fields = split(strip(fen), " \t");
+	if (fields.size() < 2)	return fail();
+
+	auto ranks = split(fields[0], "/");
+	if (ranks.size() != 8)	return fail();
+
+	state.squares.clear();
+
+	auto vec = std::vector<PieceStorage>{};
+	vec.resize(8);
+	state.squares.resize(8, vec);
+	state.width = state.height = 8;
+	_convertNulls();
+
+	//FEN lists ranks from the 8th down to the 1st
+	for (int rank = 0; rank < 8; ++rank) {
+		int file = 0;
+		for (auto c : ranks[7 - rank]) {
+			if (c >= '1' && c <= '8') {
+				file += c - '0';
+				continue;
+			}
+
+			auto type = charToType(c);
+			if (type == PieceType::None || file >= 8)	return fail();
+
+			addPiece({ rank, file++ }, type, std::isupper(c) ? Color::White : Color::Black);
+		}
+
+		if (file != 8)	return fail();
+	}
+
+	//Castling is only possible while neither the king nor the rook moved,
+	//so mark every square whose right was lost as moved
+	auto rights = fields.size() > 2 ? fields[2] : "-";
+	static const std::array<std::pair<char, Position>, 4> rookSquares = {
+		std::make_pair('K', Position{ 0, 7 }), std::make_pair('Q', Position{ 0, 0 }),
+		std::make_pair('k', Position{ 7, 7 }), std::make_pair('q', Position{ 7, 0 })
+	};
+
+	for (auto& [right, pos] : rookSquares)
+		if (rights.find(right) == rights.npos)
+			state.squares[pos.first][pos.second].didMove = true;
+
+	if (rights.find_first_of("KQ") == rights.npos)	state.squares[0][4].didMove = true;
+	if (rights.find_first_of("kq") == rights.npos)	state.squares[7][4].didMove = true;
+
+	Color toPlay = fields[1] == "b" ? Color::Black : Color::White;
+
+	//The square behind a pawn that just moved two squares holds its shadow
+	if (fields.size() > 3 && fields[3] != "-") {
+		auto pos = stringToPosition(fields[3]);
+		if (withinBounds(pos, state.width, state.height)) {
+			auto pawnColor = toPlay == Color::White ? Color::Black : Color::White;
+			state.squares[pos.first][pos.second].piecePtr = newPieceByType(PieceType::ShadowPawn, pawnColor);
+		}
+	}
+
+	GenericBoard::initialize();
+	_setPlayingColor(toPlay);
+
+	//Only the halfmove clock matters for the rules, the fullmove number is only a label
+	int halfmove = 0;
+	if (fields.size() > 4) {
+		auto last = fields[4].data() + fields[4].size();
+		auto [end, error] = std::from_chars(fields[4].data(), last, halfmove);
+		if (error != std::errc{} || end != last || halfmove < 0)	return fail();
+	}
+	_setHalfmoveClock(halfmove);
+
+	return true;
+}
@@ -28,6 +28,41 @@ inline PieceStorage _captureShadowPawn(BoardState& state, Position shadowPos) {
 	return pawnStorage;
 }
 
+/*
+	Copies a square, the per-square didMove flag included, reusing the memory
+	the threats already hold.
+*/
+inline void _copySquare(PieceStorage& to, const PieceStorage& from) {
+	to.startingPos = from.startingPos;
+	to.piecePtr = from.piecePtr;
+	to.didMove = from.didMove;
+	for (size_t idx = 0; idx < to.threat.size(); ++idx)
+		to.threat[idx].assign(from.threat[idx].begin(), from.threat[idx].end());
+}
+
+/*
+	Copies the state into a state owned by the calling thread, for trying
+	moves on without touching the original. The copy stays valid until
+	the next call on the same thread.
+*/
+BoardState& _scratchCopy(const BoardState& state) {
+	ProfileDeclare;
+	thread_local BoardState scratch = getEmptyBoardState();
+
+	scratch.width = state.width;
+	scratch.height = state.height;
+	scratch.type = state.type;
+	scratch.squares.resize(state.squares.size());
+
+	for (size_t rank = 0; rank < state.squares.size(); ++rank) {
+		scratch.squares[rank].resize(state.squares[rank].size());
+		for (size_t file = 0; file < state.squares[rank].size(); ++file)
+			_copySquare(scratch.squares[rank][file], state.squares[rank][file]);
+	}
+
+	return scratch;
+}
+
 bool GenericBoard::withinBounds(Position pos, int width, int height) const {
 	return !(pos.first < 0 || pos.second < 0 ||
 			pos.first >= height || pos.second >= width);
@@ -119,23 +154,23 @@ void GenericBoard::_removeShadows(Color ofColor)
 	}
 }
 
-bool GenericBoard::_checkStalemate()
+bool GenericBoard::_checkStalemate() const
 {
 	return _checkStalemate(currentPlayer);
 }
 
-bool GenericBoard::_checkStalemate(Color forColor)
+bool GenericBoard::_checkStalemate(Color forColor) const
 {
 	ProfileDeclare;
 	return (!getAvailableMoveCount(forColor) && !_isChecked(getKing(forColor)));
 }
 
-bool GenericBoard::_checkCheckmate()
+bool GenericBoard::_checkCheckmate() const
 {
 	return _checkCheckmate(currentPlayer);
 }
 
-bool GenericBoard::_checkCheckmate(Color forColor)
+bool GenericBoard::_checkCheckmate(Color forColor) const
 {
 	ProfileDeclare;
 	return (!getAvailableMoveCount(forColor) && _isChecked(getKing(forColor)));
@@ -392,15 +427,17 @@ Position GenericBoard::getKingPos(const BoardState& state, Color color) const
 	return { -1, -1 };
 }
 
-int GenericBoard::getAvailableMoveCount()
+int GenericBoard::getAvailableMoveCount() const
 {
 	ProfileDeclare;
 	return getAvailableMoveCount(getPlayingColor());
 }
 
-int GenericBoard::getAvailableMoveCount(Color color)
+int GenericBoard::getAvailableMoveCount(Color color) const
 {
 	ProfileDeclare;
+	auto& scratch = _scratchCopy(state);
+
 	int counter = 0;
 	for (size_t rank = 0; rank < state.squares.size(); ++rank) {
 		for (size_t file = 0; file < state.squares[rank].size(); ++file) {
@@ -408,7 +445,9 @@ int GenericBoard::getAvailableMoveCount(Color color)
 			if (!piece)						continue;
 			if (piece->getColor() != color)	continue;
 			Position pos = { static_cast<int>(rank), static_cast<int>(file) };
-			counter += getPossibleMoves(pos).size();
+
+			for (auto& to : piece->getAllAvailableMoves(pos, state))
+				counter += _canDoMove(state, scratch, pos, to);
 		}
 	}
 	return counter;
@@ -417,30 +456,12 @@ int GenericBoard::getAvailableMoveCount(Color color)
 bool GenericBoard::_continualCheckCalc(Color checking) const
 {
 	ProfileDeclare;
-
-	auto cToIdx = [](Color c) {
-		return c == Color::White ? 1 : 0;
-	};
-
-	auto kingPos = getKingPos(state, checking);
-
-	for (auto& piecePos : piecesVector[cToIdx(checking)]) {
-		for (auto& p : getPieceStorage(piecePos).piecePtr->getAllThreateningMoves(piecePos, state)) {
-			if (p == kingPos)	return true;
-		}
-	}
-
-	return false;
+	return _continualCheckCalc(state, checking);
 }
 
-bool GenericBoard::_continualCheckCalc(BoardState& state, Color checking) const
+bool GenericBoard::_continualCheckCalc(const BoardState& state, Color checking) const
 {
 	ProfileDeclare;
-
-	auto cToIdx = [](Color c) {
-		return c == Color::White ? 1 : 0;
-	};
-
 	auto kingPos = getKingPos(state, checking);
 
 	for (size_t rank = 0; rank < state.squares.size(); ++rank) {
@@ -518,13 +539,16 @@ void GenericBoard::initialize()
 	turnStrings.shrink_to_fit();
 	turnStrings.resize(1);
 	turnNumber = 1;
-	lastProgress = 1;
+	lastProgress = 0;
+	gameEnd = GameEnd::None;
 	moveNumber = 1;
 
+	_convertNulls();
+	_rebuildPieceVectors();
+
 	configurations.fill({});
 	_checkRepetition();
 
-	_convertNulls();
 	recalculateThreat();
 }
 
@@ -697,22 +721,22 @@ bool GenericBoard::tryMove(Position toPos)
 	return tryMove(selected, toPos);
 }
 
-std::vector<Position> GenericBoard::getPossibleMoves()
+std::vector<Position> GenericBoard::getPossibleMoves() const
 {
 	return getPossibleMoves(state, selected);
 }
 
-std::vector<Position> GenericBoard::getPossibleMoves(Position pieceAtPos)
+std::vector<Position> GenericBoard::getPossibleMoves(Position pieceAtPos) const
 {
 	return getPossibleMoves(state, pieceAtPos);
 }
 
-std::vector<Position> GenericBoard::getPossibleMoves(const BoardState& state)
+std::vector<Position> GenericBoard::getPossibleMoves(const BoardState& state) const
 {
 	return getPossibleMoves(state, selected);
 }
 
-std::vector<Position> GenericBoard::getPossibleMoves(const BoardState& state, Position pieceAtPos)
+std::vector<Position> GenericBoard::getPossibleMoves(const BoardState& state, Position pieceAtPos) const
 {
 	ProfileDeclare;
 	if (!withinBounds(pieceAtPos, state.width, state.height))
@@ -721,25 +745,176 @@ std::vector<Position> GenericBoard::getPossibleMoves(const BoardState& state, Po
 	auto& piece = state.squares[pieceAtPos.first][pieceAtPos.second];
 	if (!piece.piecePtr)	return {};
 
+	auto& scratch = _scratchCopy(state);
 	std::vector<Position> filtered;
 
 	for (auto& pos : piece.piecePtr->getAllAvailableMoves(pieceAtPos, state)) {
-		if (_canDoMove(pieceAtPos, pos))
+		if (_canDoMove(state, scratch, pieceAtPos, pos))
 			filtered.push_back(pos);
 	}
 
 	return filtered;
 }
 
+std::vector<std::pair<Position, Position>> GenericBoard::getAllPossibleMoves(Color forColor) const
+{
+	ProfileDeclare;
+	auto& scratch = _scratchCopy(state);
+	std::vector<std::pair<Position, Position>> moves;
+
+	for (auto from : getPieces(forColor)) {
+		auto& piece = state.squares[from.first][from.second].piecePtr;
+		for (auto& to : piece->getAllAvailableMoves(from, state)) {
+			if (_canDoMove(state, scratch, from, to))
+				moves.emplace_back(from, to);
+		}
+	}
+
+	return moves;
+}
+
+bool GenericBoard::isLegalMove(Position fromPos, Position toPos) const
+{
+	ProfileDeclare;
+	return _canDoMove(fromPos, toPos);
+}
+
+bool GenericBoard::isChecked(Color color) const
+{
+	ProfileDeclare;
+	return _isChecked(getKing(color));
+}
+
+std::vector<Position> GenericBoard::getAttackers(Position atPos, Color byColor) const
+{
+	ProfileDeclare;
+	if (!withinBounds(atPos, state.width, state.height))
+		return {};
+
+	//Threats are indexed by the attacking color, white first
+	auto& threats = state.squares[atPos.first][atPos.second].threat[byColor == Color::White ? 0 : 1];
+
+	std::vector<Position> attackers;
+	for (auto& [from, type] : threats)
+		attackers.push_back(from);
+
+	return attackers;
+}
+
+int GenericBoard::staticExchange(Position fromPos, Position toPos) const
+{
+	ProfileDeclare;
+	if (!withinBounds(fromPos, state.width, state.height) || !withinBounds(toPos, state.width, state.height))
+		return 0;
+
+	auto& mover = state.squares[fromPos.first][fromPos.second].piecePtr;
+	if (!mover || mover->getType() == PieceType::None || mover->getType() == PieceType::ShadowPawn)
+		return 0;
+
+	struct Attacker {
+		Position pos;
+		PieceType type;
+		Color color;
+	};
+
+	//Threats are indexed by the attacking color, white first
+	auto& threats = state.squares[toPos.first][toPos.second].threat;
+	auto& target = state.squares[toPos.first][toPos.second].piecePtr;
+	auto targetType = target ? target->getType() : PieceType::None;
+	auto defender = targetType != PieceType::None && targetType != PieceType::ShadowPawn
+		? target->getColor() : Color::None;
+
+	std::vector<Attacker> attackers;
+	for (auto [color, idx] : { std::make_pair(Color::White, 0), std::make_pair(Color::Black, 1) }) {
+		if (color == defender)	continue;
+		for (auto& [pos, type] : threats[idx])
+			if (pos != fromPos)	attackers.push_back({ pos, type, color });
+	}
+
+	//Pieces do not threaten their own, so defenders are found as if the moved piece already stood there
+	if (defender != Color::None) {
+		auto& scratch = _scratchCopy(state);
+		scratch.squares[toPos.first][toPos.second].piecePtr = mover;
+
+		for (auto pos : getPieces(defender)) {
+			auto& piece = state.squares[pos.first][pos.second].piecePtr;
+			auto targets = piece->getAllThreateningMoves(pos, scratch);
+			if (std::find(targets.begin(), targets.end(), toPos) != targets.end())
+				attackers.push_back({ pos, piece->getType(), defender });
+		}
+	}
+
+	//The king is worth more than anything it could win, so it only captures last
+	auto _value = [](PieceType type) {
+		return type == PieceType::King ? 10000 : pieceValue(type);
+	};
+
+	//A slider behind a piece that left the square joins in
+	auto _addHidden = [&](Position left) {
+		int dRank = (left.first > toPos.first) - (left.first < toPos.first);
+		int dFile = (left.second > toPos.second) - (left.second < toPos.second);
+		if (dRank && dFile && std::abs(left.first - toPos.first) != std::abs(left.second - toPos.second))
+			return;
+
+		Position pos = { static_cast<int8_t>(left.first + dRank), static_cast<int8_t>(left.second + dFile) };
+		for (; withinBounds(pos, state.width, state.height); pos.first += dRank, pos.second += dFile) {
+			auto& piece = state.squares[pos.first][pos.second].piecePtr;
+			if (!piece)	continue;
+
+			auto type = piece->getType();
+			if (type == PieceType::None || type == PieceType::ShadowPawn)	continue;
+
+			bool diagonal = dRank && dFile;
+			if (type == PieceType::Queen || type == (diagonal ? PieceType::Bishop : PieceType::Rook))
+				attackers.push_back({ pos, type, piece->getColor() });
+			return;
+		}
+	};
+
+	//gain[n] is what the player making the n-th capture wins, if it is the last one
+	std::vector<int> gain;
+	if (targetType == PieceType::ShadowPawn)
+		gain.push_back(mover->getType() == PieceType::Pawn ? pieceValue(PieceType::Pawn) : 0);
+	else
+		gain.push_back(_value(targetType));
+
+	auto onSquare = mover->getType();
+	auto turn = mover->getColor() == Color::White ? Color::Black : Color::White;
+	_addHidden(fromPos);
+
+	while (true) {
+		auto cheapest = attackers.end();
+		for (auto it = attackers.begin(); it != attackers.end(); ++it)
+			if (it->color == turn && (cheapest == attackers.end() || _value(it->type) < _value(cheapest->type)))
+				cheapest = it;
+		if (cheapest == attackers.end())	break;
+
+		gain.push_back(_value(onSquare) - gain.back());
+		onSquare = cheapest->type;
+		auto left = cheapest->pos;
+		attackers.erase(cheapest);
+		_addHidden(left);
+		turn = turn == Color::White ? Color::Black : Color::White;
+	}
+
+	return resolveExchange(gain.data(), static_cast<int>(gain.size()) - 1);
+}
+
 Color GenericBoard::getWinner() const
 {
 	return winner;
 }
 
+GameEnd GenericBoard::getGameEnd() const
+{
+	return gameEnd;
+}
+
 void GenericBoard::forfeit()
 {
 	if (winner != Color::None)	return;
 	winner = currentPlayer == Color::White ? Color::Black : Color::White;
+	gameEnd = GameEnd::Forfeit;
 	writeDownForfeit();
 }
 
@@ -748,6 +923,12 @@ int GenericBoard::getTurn() const
 	return turnNumber;
 }
 
+int GenericBoard::getHalfmoveClock() const
+{
+	//moveNumber already points at the next move
+	return moveNumber - 1 - lastProgress;
+}
+
 std::pair<std::string, std::string> GenericBoard::getTurnInfo() const
 {
 	if (!turnStrings.size())	return {};
@@ -792,9 +973,9 @@ void GenericBoard::_addPieceToVector(Color ofColor, Position pos)
 	pieces.emplace_back(pos);
 }
 
-bool GenericBoard::_canDoMove(Position fromPos, Position toPos)
+bool GenericBoard::_canDoMove(Position fromPos, Position toPos) const
 {
-	return _canDoMove(state, fromPos, toPos);
+	return _canDoMove(state, _scratchCopy(state), fromPos, toPos);
 }
 
 void GenericBoard::_performMove(Position fromPos, Position toPos)
@@ -802,7 +983,7 @@ void GenericBoard::_performMove(Position fromPos, Position toPos)
 	_performMove(state, fromPos, toPos);
 }
 
-bool GenericBoard::_canDoMove(BoardState& state, Position fromPos, Position toPos)
+bool GenericBoard::_canDoMove(const BoardState& state, BoardState& scratch, Position fromPos, Position toPos) const
 {
 	ProfileDeclare;
 
@@ -810,65 +991,32 @@ bool GenericBoard::_canDoMove(BoardState& state, Position fromPos, Position toPo
 		!withinBounds(toPos, state.width, state.height))
 		return false;
 
-	auto piece = state.squares[fromPos.first][fromPos.second];
-	if (!piece.piecePtr)	return false;
-
-	auto pieceType = piece.piecePtr->getType();
-	auto thisPlayer = piece.piecePtr->getColor();
-	auto enemyPlayer = thisPlayer == Color::White ? 1 : 0;
-
-	auto target = state.squares[toPos.first][toPos.second];
-	auto targetType = target.piecePtr->getType();
-	auto targetColor = target.piecePtr->getColor();
+	auto& piece = state.squares[fromPos.first][fromPos.second].piecePtr;
+	if (!piece)	return false;
 
-	static auto _shadowToPawnPos = [](Position shadow, Color color) {
-		if (color == Color::White)	return Position{ shadow.first + 1, shadow.second };
-		return Position{ shadow.first - 1, shadow.second };
+	//The move is played on the scratch copy, which holds the same position as the state
+	if (!piece->move(fromPos, toPos, scratch).first)	return false;
+	bool legal = !_continualCheckCalc(scratch, piece->getColor());
+
+	/*
+		Return every square the move could have changed: the pawn captured
+		en passant stands next to the pawn that took it, the shadow of a double
+		pawn push between the squares it moved over, and a castling rook moves
+		from the corner to the square the king skipped.
+	*/
+	std::array<Position, 6> touched = {
+		fromPos,
+		toPos,
+		Position{ fromPos.first, toPos.second },
+		Position{ (fromPos.first + toPos.first) / 2, fromPos.second },
+		Position{ fromPos.first, (fromPos.second + toPos.second) / 2 },
+		Position{ fromPos.first, toPos.second < fromPos.second ? 0 : state.width - 1 },
 	};
 
-	auto diff = Position{ fromPos.first - toPos.first, fromPos.second - toPos.second };
-
-	if (targetType == PieceType::ShadowPawn
-		&& pieceType == PieceType::Pawn) {
-		auto realPawnPos = _shadowToPawnPos(toPos, targetColor);
-		auto realPawn = state.squares[realPawnPos.first][realPawnPos.second];
+	for (auto pos : touched)
+		_copySquare(scratch.squares[pos.first][pos.second], state.squares[pos.first][pos.second]);
 
-		if (!piece.piecePtr->move(fromPos, toPos, state).first)	return false;
-		bool b = !_continualCheckCalc(thisPlayer);
-
-		//return the pawn we moved
-		state.squares[fromPos.first][fromPos.second] = piece;
-		//return the shadow
-		state.squares[toPos.first][toPos.second] = target;
-		//return the captured pawn via shadow proxy
-		state.squares[realPawnPos.first][realPawnPos.second] = realPawn;
-
-		return b;
-	}
-	else if (pieceType == PieceType::Pawn && std::abs(diff.first) == 2) {
-		auto pawnRestart = Position{ toPos.first + 1, toPos.second };
-		auto pawnRestartS = state.squares[pawnRestart.first][pawnRestart.second];
-
-		if (!piece.piecePtr->move(fromPos, toPos, state).first)	return false;
-		bool b = !_continualCheckCalc(thisPlayer);
-
-		//return the pawn
-		state.squares[fromPos.first][fromPos.second] = piece;
-		//remove its shadow
-		state.squares[pawnRestart.first][pawnRestart.second] = pawnRestartS;
-
-		return b;
-	}
-	else {
-		if (!piece.piecePtr->move(fromPos, toPos, state).first)	return false;
-		bool b = !_continualCheckCalc(thisPlayer);
-
-		//return the piece that moved
-		state.squares[fromPos.first][fromPos.second] = piece;
-		//return the piece that was potentially captured
-		state.squares[toPos.first][toPos.second] = target;
-		return b;
-	}
+	return legal;
 }
 
 void GenericBoard::_performMove(BoardState& state, Position fromPos, Position toPos)
@@ -885,6 +1033,10 @@ void GenericBoard::_performMove(BoardState& state, Position fromPos, Position to
 	if (!piece.piecePtr)	return;
 	if (piece.piecePtr->getColor() != currentPlayer)	return;
 
+	//The square is emptied by the move, remember what stood on both squares
+	auto movedType = piece.piecePtr->getType();
+	auto targetType = state.squares[toPos.first][toPos.second].piecePtr->getType();
+
 	//Attempt to move, the move itself will return whether it was success
 	//or not so we dont have to double check possibility.
 	auto moved = piece.piecePtr->move(fromPos, toPos, state);
@@ -895,19 +1047,29 @@ void GenericBoard::_performMove(BoardState& state, Position fromPos, Position to
 	_removePieceFromVector(currentPlayer, fromPos);
 	_addPieceToVector(currentPlayer, toPos);
 
+	//Castling moves the rook too
+	if (movedType == PieceType::King && std::abs(fromPos.second - toPos.second) == 2) {
+		bool kingSide = toPos.second > fromPos.second;
+		_removePieceFromVector(currentPlayer, { fromPos.first, kingSide ? state.width - 1 : 0 });
+		_addPieceToVector(currentPlayer, { fromPos.first, (fromPos.second + toPos.second) / 2 });
+	}
+
 	//if the piece we moved on top of is not nullptr and its not None
-	//store it in its player's graveyard
-	if (moved.second.piecePtr && moved.second.piecePtr->getType() != PieceType::None) {
+	//store it in its player's graveyard, only pawns capture shadows
+	auto capturedType = moved.second.piecePtr ? moved.second.piecePtr->getType() : PieceType::None;
+	if (capturedType != PieceType::None && capturedType != PieceType::ShadowPawn) {
 		auto movedColor = moved.second.piecePtr->getColor();
 		getGraveyard(movedColor).push_back(moved.second);
-		
-		_removePieceFromVector(movedColor, toPos);
+
+		//A pawn taken en passant stands next to the square it was taken on
+		auto capturedPos = targetType == PieceType::ShadowPawn ? Position{ fromPos.first, toPos.second } : toPos;
+		_removePieceFromVector(movedColor, capturedPos);
 
 		//we captured, update last progress number
 		lastProgress = moveNumber;
 	}
 	//If we moved pawn even if we didnt capture, its progress
-	else if (piece.piecePtr->getType() == PieceType::Pawn) {
+	else if (movedType == PieceType::Pawn) {
 		lastProgress = moveNumber;
 	}
 }
@@ -917,20 +1079,113 @@ void GenericBoard::_switchColor()
 	currentPlayer = currentPlayer == Color::White ? Color::Black : Color::White;
 }
 
+void GenericBoard::_setPlayingColor(Color color)
+{
+	currentPlayer = color;
+	configurations.fill({});
+	_checkRepetition();
+}
+
+void GenericBoard::_setHalfmoveClock(int halfmove)
+{
+	lastProgress = moveNumber - 1 - halfmove;
+}
+
+void GenericBoard::_rebuildPieceVectors()
+{
+	piecesVector.fill({});
+	for (size_t rank = 0; rank < state.squares.size(); ++rank) {
+		for (size_t file = 0; file < state.squares[rank].size(); ++file) {
+			auto& piece = state.squares[rank][file].piecePtr;
+			auto type = piece->getType();
+			if (type == PieceType::None || type == PieceType::ShadowPawn)
+				continue;
+
+			_addPieceToVector(piece->getColor(), { static_cast<int>(rank), static_cast<int>(file) });
+		}
+	}
+}
+
 void GenericBoard::_checkStaleOrCheckmate()
 {
 	ProfileDeclare;
 	auto movesAvailable = getAvailableMoveCount();
 	bool checked = _isChecked(getKing());
 
-	if ((!movesAvailable && !checked) || moveNumber + 50 <= lastProgress || _checkRepetition()) {
+	//Mate takes precedence over a draw reached by the same move
+	if (!movesAvailable && checked) {
+		_switchColor();
+		winner = currentPlayer;
+		currentPlayer = Color::None;
+		gameEnd = GameEnd::Checkmate;
+		return;
+	}
+
+	if (!movesAvailable)
+		gameEnd = GameEnd::Stalemate;
+	//moveNumber counts single moves of either player and already points at
+	//the next one, so 100 of them since the last progress make a difference over 100
+	else if (moveNumber - lastProgress > 100)
+		gameEnd = GameEnd::FiftyMoves;
+	else if (_checkRepetition())
+		gameEnd = GameEnd::Repetition;
+
+	if (gameEnd != GameEnd::None) {
 		winner = Color::Pat;
 		writeDownPat();
 		currentPlayer = Color::None;
 	}
-	else if (!movesAvailable && checked) {
-		_switchColor();
-		winner = currentPlayer;
-		currentPlayer = Color::None;
+}
+
+size_t GenericBoard::memoryUsage() const
+{
+	ProfileDeclare;
+	//Strings short enough to fit into the object itself allocate nothing
+	auto _stringHeap = [](const std::string& str) -> size_t {
+		return str.capacity() >= sizeof(std::string) ? str.capacity() + 1 : 0;
+	};
+
+	auto _storageHeap = [](const PieceStorage& storage) {
+		size_t bytes = 0;
+		for (auto& threat : storage.threat)
+			bytes += threat.capacity() * sizeof(threat_t::value_type);
+		return bytes;
+	};
+
+	size_t bytes = sizeof(*this);
+
+	bytes += state.squares.capacity() * sizeof(state.squares[0]);
+	for (auto& row : state.squares) {
+		bytes += row.capacity() * sizeof(PieceStorage);
+		for (auto& square : row)
+			bytes += _storageHeap(square);
 	}
-}
\ No newline at end of file
+
+	for (auto grave : { &whiteGrave, &blackGrave }) {
+		bytes += grave->capacity() * sizeof(PieceStorage);
+		for (auto& storage : *grave)
+			bytes += _storageHeap(storage);
+	}
+
+	for (auto& pieces : piecesVector)
+		bytes += pieces.capacity() * sizeof(Position);
+
+	bytes += turnStrings.capacity() * sizeof(turnStrings[0]);
+	for (auto& [white, black] : turnStrings)
+		bytes += _stringHeap(white) + _stringHeap(black);
+
+	//Every node of the map holds the key, the value, the next pointer and the hash
+	for (auto& conf : configurations) {
+		bytes += conf.bucket_count() * sizeof(void*);
+		for (auto& [position, count] : conf)
+			bytes += sizeof(std::pair<const std::string, int>) + 2 * sizeof(void*) + _stringHeap(position);
+	}
+
+	return bytes;
+}
+
+std::shared_ptr<GenericBoard> GenericBoard::clone() const
+{
+	ProfileDeclare;
+	return std::make_shared<GenericBoard>(*this);
+}
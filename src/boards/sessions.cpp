@@ -0,0 +1,127 @@
+#include "../../include/boards/sessions.hpp"
+#include "../../include/boards/boardbuilder.hpp"
+
+#include "../../include/profiler.hpp"
+
+session_id_t SessionManager::create(BoardType type)
+{
+	ProfileDeclare;
+	//Reserve the place first, so concurrent calls cannot go over the limit
+	if (count.fetch_add(1, std::memory_order_relaxed) >= limit && limit) {
+		count.fetch_sub(1, std::memory_order_relaxed);
+		return 0;
+	}
+
+	auto session = std::make_shared<GameSession>();
+	session->board = newBoard(type);
+	if (!session->board) {
+		count.fetch_sub(1, std::memory_order_relaxed);
+		return 0;
+	}
+
+	session->board->initialize();
+	session->id = nextId.fetch_add(1, std::memory_order_relaxed);
+
+	auto& shard = _shard(session->id);
+	std::lock_guard guard{ shard.lock };
+	shard.sessions.emplace(session->id, session);
+
+	return session->id;
+}
+
+std::shared_ptr<GameSession> SessionManager::find(session_id_t id) const
+{
+	ProfileDeclare;
+	auto& shard = _shard(id);
+	std::lock_guard guard{ shard.lock };
+
+	auto found = shard.sessions.find(id);
+	if (found == shard.sessions.end())	return nullptr;
+	return found->second;
+}
+
+std::shared_ptr<const GenericBoard> SessionManager::view(session_id_t id) const
+{
+	ProfileDeclare;
+	auto session = find(id);
+	if (!session)	return nullptr;
+
+	std::lock_guard guard{ session->lock };
+	if (session->changed || !session->published) {
+		session->published = session->board->clone();
+		session->changed = false;
+	}
+
+	return session->published;
+}
+
+bool SessionManager::close(session_id_t id)
+{
+	ProfileDeclare;
+	std::shared_ptr<GameSession> closed;
+	{
+		auto& shard = _shard(id);
+		std::lock_guard guard{ shard.lock };
+
+		auto found = shard.sessions.find(id);
+		if (found == shard.sessions.end())	return false;
+
+		closed = std::move(found->second);
+		shard.sessions.erase(found);
+	}
+
+	count.fetch_sub(1, std::memory_order_relaxed);
+	//The board is freed here, outside of the shard lock, unless someone still holds the session
+	return true;
+}
+
+std::vector<session_id_t> SessionManager::ids() const
+{
+	ProfileDeclare;
+	std::vector<session_id_t> all;
+	all.reserve(size());
+
+	for (auto& shard : shards) {
+		std::lock_guard guard{ shard.lock };
+		for (auto& [id, session] : shard.sessions)
+			all.push_back(id);
+	}
+
+	return all;
+}
+
+size_t SessionManager::memoryUsage() const
+{
+	ProfileDeclare;
+	size_t bytes = sizeof(*this);
+	std::vector<std::shared_ptr<GameSession>> sessions;
+
+	for (auto& shard : shards) {
+		std::lock_guard guard{ shard.lock };
+		bytes += shard.sessions.bucket_count() * sizeof(void*);
+		for (auto& [id, session] : shard.sessions)
+			sessions.push_back(session);
+	}
+
+	//Boards are measured outside of the shard locks, games being played only block themselves
+	for (auto& session : sessions) {
+		std::lock_guard guard{ session->lock };
+		bytes += sessionOverhead() + session->board->memoryUsage();
+		if (session->published)
+			bytes += session->published->memoryUsage();
+	}
+
+	return bytes;
+}
+
+size_t SessionManager::sessionOverhead()
+{
+	/*
+		The session and its reference counts are allocated together,
+		the same goes for the board. The node of the map holds the key,
+		the pointer, the next pointer and the hash.
+	*/
+	constexpr size_t controlBlock = 2 * sizeof(void*) + 2 * sizeof(int);
+	return sizeof(GameSession) + 2 * controlBlock
+		+ sizeof(std::pair<const session_id_t, std::shared_ptr<GameSession>>) + 2 * sizeof(void*);
+}
@@ -10,32 +10,60 @@
 
 #include "../../include/profiler.hpp"
 
+#include <array>
+
+static constexpr size_t _typeCount = static_cast<size_t>(PieceType::None) + 1;
+static constexpr size_t _colorCount = static_cast<size_t>(Color::None) + 1;
+
+using piece_table_t = std::array<std::array<std::shared_ptr<PieceGeneric>, _colorCount>, _typeCount>;
+
+/*
+	Builds a new piece, for filling the table of shared pieces.
+*/
+std::shared_ptr<PieceGeneric> _buildPiece(PieceType type, Color c) {
+	switch (type) {
+	case PieceType::Bishop:
+		return std::make_shared<PieceBishop>(c);
+	case PieceType::King:
+		return std::make_shared<PieceKing>(c);
+	case PieceType::Pawn:
+		return std::make_shared<PiecePawn>(c);
+	case PieceType::Queen:
+		return std::make_shared<PieceQueen>(c);
+	case PieceType::Rook:
+		return std::make_shared<PieceRook>(c);
+	case PieceType::Knight:
+		return std::make_shared<PieceKnight>(c);
+	case PieceType::None:
+		return std::make_shared<PieceGeneric>(c);
+	case PieceType::ShadowPawn:
+		return std::make_shared<PieceShadowPawn>(c);
+	default:
+		return nullptr;
+	}
+}
+
+piece_table_t _buildPieceTable() {
+	piece_table_t table;
+	for (size_t type = 0; type < _typeCount; ++type)
+		for (size_t color = 0; color < _colorCount; ++color)
+			table[type][color] = _buildPiece(static_cast<PieceType>(type), static_cast<Color>(color));
+	return table;
+}
 
 std::shared_ptr<PieceGeneric> newPieceByType(PieceType type, Color c)
 {
 	ProfileDeclare;
-	auto _builder = [](PieceType type, Color c) -> std::shared_ptr<PieceGeneric> {
-		switch (type) {
-		case PieceType::Bishop:
-			return std::make_shared<PieceBishop>(c);
-		case PieceType::King:
-			return std::make_shared<PieceKing>(c);
-		case PieceType::Pawn:
-			return std::make_shared<PiecePawn>(c);
-		case PieceType::Queen:
-			return std::make_shared<PieceQueen>(c);
-		case PieceType::Rook:
-			return std::make_shared<PieceRook>(c);
-		case PieceType::Knight:
-			return std::make_shared<PieceKnight>(c);
-		case PieceType::None:
-			return std::make_shared<PieceGeneric>(c);
-		case PieceType::ShadowPawn:
-			return std::make_shared<PieceShadowPawn>(c);
-		default:
-			return nullptr;
-		}
-	};
-
-	return _builder(type, c);
+	/*
+		Every thread has its own table, so the reference counts of pieces
+		used by boards of different threads do not bounce between cores.
+	*/
+	thread_local piece_table_t table = _buildPieceTable();
+
+	auto typeIdx = static_cast<size_t>(type);
+	auto colorIdx = static_cast<size_t>(c);
+	if (typeIdx >= _typeCount || colorIdx >= _colorCount)
+		return nullptr;
+
+	return table[typeIdx][colorIdx];
 }
@@ -0,0 +1,170 @@
+/*
+	Decodes files written by the binary mode of the Profiler.
+
+	Usage: profdecode FILE [text|trace|stats] [verbose]
+
+	text (default) prints one line per call in the same format as the text mode,
+	trace prints Chrome trace-event JSON and stats prints the aggregated table.
+	verbose uses full function signatures instead of plain names.
+*/
+
+#include "../../include/profiler.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+struct DecodedSite {
+	std::string funcName;
+	std::string richFuncName;
+	std::string file;
+	int line = 0;
+};
+
+template <class T>
+bool readValue(std::ifstream& in, T& value) {
+	return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+bool readString(std::ifstream& in, std::string& str) {
+	uint16_t length = 0;
+	if (!readValue(in, length))	return false;
+	str.resize(length);
+	return length == 0 || static_cast<bool>(in.read(&str[0], length));
+}
+
+std::string jsonEscape(const std::string& str) {
+	std::string escaped;
+	for (auto c : str) {
+		if (c == '"' || c == '\\')
+			escaped += '\\';
+		escaped += c;
+	}
+	return escaped;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " FILE [text|trace|stats] [verbose]\n";
+		return 1;
+	}
+
+	std::string format = argc > 2 ? argv[2] : "text";
+	bool verbose = argc > 3 && std::string{ argv[3] } == "verbose";
+
+	std::ifstream in{ argv[1], std::ios_base::binary };
+	char magic[sizeof(profileMagic)] = {};
+	if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, profileMagic, sizeof(magic))) {
+		std::cerr << argv[1] << " is not a binary profile.\n";
+		return 1;
+	}
+
+	std::vector<DecodedSite> sites;
+	std::vector<ProfileEvent> events;
+	uint64_t dropped = 0;
+
+	ProfileRecord tag;
+	while (readValue(in, tag)) {
+		if (tag == ProfileRecord::Site) {
+			uint32_t id = 0;
+			DecodedSite site;
+			if (!readValue(in, id) || !readValue(in, site.line) || !readString(in, site.funcName)
+				|| !readString(in, site.richFuncName) || !readString(in, site.file))
+				break;
+
+			if (sites.size() <= id)	sites.resize(id + 1);
+			sites[id] = std::move(site);
+		}
+		else if (tag == ProfileRecord::Events) {
+			uint32_t count = 0;
+			if (!readValue(in, count))	break;
+			auto at = events.size();
+			events.resize(at + count);
+			if (!in.read(reinterpret_cast<char*>(&events[at]), count * sizeof(ProfileEvent))) {
+				events.resize(at);
+				break;
+			}
+		}
+		else if (tag == ProfileRecord::Dropped) {
+			readValue(in, dropped);
+		}
+		else {
+			std::cerr << "Unknown record in " << argv[1] << ", the file is likely damaged.\n";
+			break;
+		}
+	}
+
+	//Sites are always written before the writer finishes, but a file cut off
+	//mid-write can still reference unknown ones
+	auto siteOf = [&](uint32_t id) -> const DecodedSite& {
+		static DecodedSite unknown{ "(unknown)", "(unknown)", "", 0 };
+		return id < sites.size() ? sites[id] : unknown;
+	};
+
+	auto nameOf = [&](const DecodedSite& site) {
+		return verbose ? site.richFuncName : site.funcName;
+	};
+
+	auto fileNameOf = [](const DecodedSite& site) {
+		return site.file.substr(site.file.find_last_of('\\') + 1);
+	};
+
+	if (format == "trace") {
+		std::cout << "{\"traceEvents\":[\n"
+			"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"chess\"}}";
+
+		for (auto& event : events) {
+			auto& site = siteOf(event.siteId);
+			char times[96];
+			snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,",
+					 event.start / 1000.0, event.duration / 1000.0, event.threadId);
+
+			std::cout << ",\n{\"name\":\"" << jsonEscape(nameOf(site)) << "\",\"cat\":\""
+				<< jsonEscape(fileNameOf(site)) << "\",\"ph\":\"X\"," << times
+				<< "\"args\":{\"line\":" << site.line << "}}";
+		}
+
+		std::cout << "\n],\n\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+	}
+	else if (format == "stats") {
+		std::vector<SiteStats> stats(sites.size());
+		for (auto& event : events)
+			if (event.siteId < stats.size())
+				stats[event.siteId].add(event.duration);
+
+		std::vector<size_t> order;
+		for (size_t idx = 0; idx < stats.size(); ++idx)
+			if (stats[idx].count)	order.push_back(idx);
+
+		std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+			return stats[lhs].total > stats[rhs].total;
+		});
+
+		for (auto idx : order) {
+			auto& s = stats[idx];
+			std::cout << s.count << " calls, total " << formatDuration(s.total)
+				<< ", p50 " << formatDuration(s.percentile(0.5))
+				<< ", p99 " << formatDuration(s.percentile(0.99))
+				<< ", " << nameOf(sites[idx]) << " (" << fileNameOf(sites[idx])
+				<< ", line " << sites[idx].line << ")\n";
+		}
+	}
+	else {
+		for (auto& event : events) {
+			auto& site = siteOf(event.siteId);
+			std::cout << "File \"" << fileNameOf(site) << "\", line " << site.line
+				<< ", in " << nameOf(site) << " (Executed in "
+				<< formatDuration(event.duration) << ", thread " << event.threadId << ").\n";
+		}
+	}
+
+	if (dropped)
+		std::cerr << dropped << " events were dropped because the writer could not keep up.\n";
+
+	return 0;
+}
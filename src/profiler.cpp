@@ -2,28 +2,461 @@
 #include <cstdlib>
 #include <fstream>
 #include <string>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <condition_variable>
+#include <map>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static ProfileSite systemSite{ "system", "system", "", 0 };
 
 std::string Profiler::targetFile;
-Profiler::callstack_t Profiler::callstack = { { "system", "system", "", "0",
-												chrono::high_resolution_clock::now().time_since_epoch() } };
-int Profiler::_verbosity = 0;
-std::string Profiler::buffer;
-timepoint_t Profiler::totalSpent;
-int Profiler::_traceback = 0;
+std::atomic<bool> Profiler::active = false;
+std::atomic<int> Profiler::_verbosity = 0;
+std::atomic<int> Profiler::_traceback = 0;
+std::atomic<ProfileMode> Profiler::_mode = ProfileMode::Text;
+std::atomic<timepoint_t> Profiler::traceStart = timepoint_t{};
+std::atomic<int> Profiler::_sampling = 1;
+std::atomic<bool> Profiler::_counters = false;
+
+/*
+	Whether anything was written into the current target file yet. The first
+	write truncates the file, every following one appends to it.
+
+	Guarded by _fileMutex, same as the name of the target file.
+*/
+static bool _fileStarted = false;
+
+/*
+	The mutexes are never destroyed, they have to stay usable while the
+	buffers are dumped at exit.
+*/
+static std::mutex& _fileMutex() {
+	static auto* mutex = new std::mutex();
+	return *mutex;
+}
+
+static std::mutex& _threadsMutex() {
+	static auto* mutex = new std::mutex();
+	return *mutex;
+}
+
+static std::mutex& _sitesMutex() {
+	static auto* mutex = new std::mutex();
+	return *mutex;
+}
+
+/*
+	Rings of threads that exited, left for the writer to drain one last time
+	and delete. Guarded by _threadsMutex.
+*/
+static std::vector<EventRing*>& _finishedRings() {
+	static auto* rings = new std::vector<EventRing*>();
+	return *rings;
+}
+
+/*
+	Patterns set by Profiler::include and Profiler::exclude, guarded by _sitesMutex.
+*/
+static std::vector<std::string>& _includes() {
+	static auto* patterns = new std::vector<std::string>();
+	return *patterns;
+}
+
+static std::vector<std::string>& _excludes() {
+	static auto* patterns = new std::vector<std::string>();
+	return *patterns;
+}
+
+/*
+	Whether the site passes the current filters, _sitesMutex has to be held.
+*/
+static bool _passesFilters(const ProfileSite& site) {
+	auto matches = [&](const std::string& pattern) {
+		return std::strstr(site.funcName, pattern.c_str()) || std::strstr(site.richFuncName, pattern.c_str())
+			|| std::strstr(site.file, pattern.c_str());
+	};
+
+	auto& includes = _includes();
+	auto& excludes = _excludes();
+	if (std::any_of(excludes.begin(), excludes.end(), matches))
+		return false;
+	return includes.empty() || std::any_of(includes.begin(), includes.end(), matches);
+}
 
 #include <iostream>
 
+ProfileSite::ProfileSite(const char* _fn, const char* _rfn, const char* _f,
+						 int _l) : funcName(_fn), richFuncName(_rfn), file(_f), line(_l)
+{
+	std::lock_guard<std::mutex> guard{ _sitesMutex() };
+	auto& all = Profiler::sites();
+	id = all.size();
+	all.push_back(this);
+	enabled.store(Profiler::active && _passesFilters(*this), std::memory_order_relaxed);
+}
+
+ThreadProfile::ThreadProfile(int _id) : id(_id)
+{
+	callstack.emplace_back(&systemSite, chrono::high_resolution_clock::now().time_since_epoch());
+	paths.emplace_back(&systemSite, 0);
+}
+
+ThreadProfile::~ThreadProfile()
+{
+	delete ring.load();
+}
+
+HardwareCounters::HardwareCounters()
+{
+	fds.fill(-1);
+	slots.fill(-1);
+}
+
+HardwareCounters::~HardwareCounters()
+{
+	close();
+}
+
+void HardwareCounters::close()
+{
+#if defined(__linux__)
+	for (auto fd : fds)
+		if (fd >= 0)	::close(fd);
+#endif
+
+	fds.fill(-1);
+	slots.fill(-1);
+	leader = -1;
+	opened = 0;
+}
+
+bool HardwareCounters::open()
+{
+#if defined(__linux__)
+	static const uint64_t configs[] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES,
+	};
+
+	//All events share one group, so they are scheduled together and read at once
+	for (size_t idx = 0; idx < fds.size(); ++idx) {
+		perf_event_attr attr = {};
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = configs[idx];
+		attr.disabled = leader < 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+
+		int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+		if (fd < 0)	continue;
+
+		if (leader < 0)	leader = fd;
+		fds[idx] = fd;
+		slots[idx] = static_cast<int>(opened++);
+	}
+
+	if (leader >= 0)
+		ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+
+	return available();
+}
+
+void HardwareCounters::read(counters_t& values) const
+{
+	values = {};
+
+#if defined(__linux__)
+	if (leader < 0)	return;
+
+	uint64_t group[1 + static_cast<size_t>(HardwareEvent::Count)];
+	if (::read(leader, group, sizeof(group)) <= 0)	return;
+
+	for (size_t idx = 0; idx < values.size(); ++idx)
+		if (slots[idx] >= 0)
+			values[idx] = group[1 + slots[idx]];
+#endif
+}
+
+/*
+	Read the hardware counters of the calling thread, opening them on first use.
+*/
+static void _readCounters(ThreadProfile& profile, counters_t& values) {
+	if (!profile.hardwareTried) {
+		profile.hardwareTried = true;
+		profile.hardware.open();
+	}
+
+	profile.hardware.read(values);
+}
+
+bool EventRing::push(const ProfileEvent& event)
+{
+	auto at = head.load(std::memory_order_relaxed);
+	if (at - tail.load(std::memory_order_acquire) >= capacity) {
+		lost.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	events[at % capacity] = event;
+	head.store(at + 1, std::memory_order_release);
+	return true;
+}
+
+size_t EventRing::drain(std::vector<ProfileEvent>& into)
+{
+	auto from = tail.load(std::memory_order_relaxed);
+	auto until = head.load(std::memory_order_acquire);
+
+	for (auto at = from; at < until; ++at)
+		into.push_back(events[at % capacity]);
+
+	tail.store(until, std::memory_order_release);
+	return until - from;
+}
+
+/*
+	Background thread of the binary mode. Wakes up every few milliseconds,
+	drains rings of all threads and appends their events to the target file.
+*/
+class _TraceWriter {
+	std::thread worker;
+	std::mutex wakeLock;
+	std::condition_variable wake;
+	bool stopping = false;
+
+	void _writeString(std::ofstream& out, const char* str) {
+		auto length = static_cast<uint16_t>(std::min<size_t>(std::strlen(str), UINT16_MAX));
+		out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+		out.write(str, length);
+	}
+
+	void _run(std::string path, std::vector<std::shared_ptr<ThreadProfile>>* threads) {
+		std::ofstream out{ path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc };
+		out.write(profileMagic, sizeof(profileMagic));
+
+		size_t sitesWritten = 0;
+		std::vector<ProfileEvent> events;
+		std::vector<EventRing*> rings;
+		std::vector<EventRing*> finished;
+		uint64_t finishedDropped = 0;
+
+		while (true) {
+			bool last;
+			{
+				std::unique_lock<std::mutex> guard{ wakeLock };
+				wake.wait_for(guard, chrono::milliseconds(10), [&] { return stopping; });
+				last = stopping;
+			}
+
+			{
+				std::lock_guard<std::mutex> guard{ _sitesMutex() };
+				auto& sites = Profiler::sites();
+				for (; sitesWritten < sites.size(); ++sitesWritten) {
+					auto& site = *sites[sitesWritten];
+					auto tag = ProfileRecord::Site;
+					uint32_t id = static_cast<uint32_t>(site.id);
+					int32_t line = site.line;
+					out.write(reinterpret_cast<const char*>(&tag), sizeof(tag));
+					out.write(reinterpret_cast<const char*>(&id), sizeof(id));
+					out.write(reinterpret_cast<const char*>(&line), sizeof(line));
+					_writeString(out, site.funcName);
+					_writeString(out, site.richFuncName);
+					_writeString(out, site.file);
+				}
+			}
+
+			rings.clear();
+			finished.clear();
+			{
+				std::lock_guard<std::mutex> guard{ _threadsMutex() };
+				for (auto& profile : *threads)
+					if (auto ring = profile->ring.load(std::memory_order_acquire))
+						rings.push_back(ring);
+				finished.swap(_finishedRings());
+			}
+
+			events.clear();
+			uint64_t dropped = 0;
+			for (auto ring : rings) {
+				ring->drain(events);
+				dropped += ring->dropped();
+			}
+
+			//Nothing is pushed into rings of exited threads anymore, a single drain empties them
+			for (auto ring : finished) {
+				ring->drain(events);
+				finishedDropped += ring->dropped();
+				delete ring;
+			}
+			dropped += finishedDropped;
+
+			if (events.size()) {
+				auto tag = ProfileRecord::Events;
+				uint32_t count = static_cast<uint32_t>(events.size());
+				out.write(reinterpret_cast<const char*>(&tag), sizeof(tag));
+				out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+				out.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(ProfileEvent));
+			}
+
+			if (last) {
+				auto tag = ProfileRecord::Dropped;
+				out.write(reinterpret_cast<const char*>(&tag), sizeof(tag));
+				out.write(reinterpret_cast<const char*>(&dropped), sizeof(dropped));
+				return;
+			}
+		}
+	}
+public:
+	void start(const std::string& path, std::vector<std::shared_ptr<ThreadProfile>>& threads) {
+		stop();
+		stopping = false;
+		worker = std::thread(&_TraceWriter::_run, this, path, &threads);
+	}
+
+	void stop() {
+		if (!worker.joinable())	return;
+		{
+			std::lock_guard<std::mutex> guard{ wakeLock };
+			stopping = true;
+		}
+		wake.notify_all();
+		worker.join();
+	}
+
+	void poke() {
+		wake.notify_all();
+	}
+};
+
+static _TraceWriter& _writer() {
+	static auto* writer = new _TraceWriter();
+	return *writer;
+}
+
+std::string ProfileSite::fileName() const
+{
+	std::string path = file;
+	return path.substr(path.find_last_of('\\') + 1);
+}
+
+inline int _log2(unsigned long long value) {
+#if defined(__GNUC__)
+	return 63 - __builtin_clzll(value);
+#elif defined(_MSC_VER)
+	unsigned long idx;
+	_BitScanReverse64(&idx, value);
+	return static_cast<int>(idx);
+#else
+	int idx = 0;
+	while (value >>= 1)	++idx;
+	return idx;
+#endif
+}
+
+void SiteStats::add(long long ns)
+{
+	if (ns < 0)	ns = 0;
+
+	++count;
+	total += ns;
+	min = std::min(min, ns);
+	max = std::max(max, ns);
+
+	//Values below subBuckets fall into their own bucket, everything else
+	//is split by its highest bit and the bits right below it
+	int idx = static_cast<int>(ns);
+	if (ns >= subBuckets) {
+		int exponent = _log2(ns);
+		int sub = static_cast<int>(ns >> (exponent - 2)) - subBuckets;
+		idx = exponent * subBuckets + sub;
+	}
+
+	histogram[std::min(idx, bucketCount - 1)]++;
+}
+
+long long SiteStats::percentile(double p) const
+{
+	if (!count)	return 0;
+
+	uint64_t wanted = static_cast<uint64_t>(p * count);
+	uint64_t seen = 0;
+
+	for (int idx = 0; idx < bucketCount; ++idx) {
+		seen += histogram[idx];
+		if (seen <= wanted || !histogram[idx])	continue;
+
+		if (idx < subBuckets)	return idx;
+
+		//Middle of the bucket, clamped to values actually observed
+		int exponent = idx / subBuckets;
+		long long lower = static_cast<long long>(subBuckets + idx % subBuckets) << (exponent - 2);
+		long long width = 1LL << (exponent - 2);
+		return std::clamp(lower + width / 2, min, max);
+	}
+
+	return max;
+}
+
+void SiteStats::merge(const SiteStats& other)
+{
+	count += other.count;
+	total += other.total;
+	min = std::min(min, other.min);
+	max = std::max(max, other.max);
+	for (int idx = 0; idx < bucketCount; ++idx)
+		histogram[idx] += other.histogram[idx];
+	for (size_t idx = 0; idx < hardware.size(); ++idx)
+		hardware[idx] += other.hardware[idx];
+}
+
+std::string formatDuration(long long counter) {
+	static const char* suffixes[] = {
+		"ns", "us", "ms", "s"
+	};
+
+	long long bottom = 0;
+	int idx = 0;
+
+	while (counter > 1000 && idx < 3) {
+		idx++;
+		bottom = counter % 1000;
+		counter /= 1000;
+	}
+
+	return std::to_string(counter + (bottom / 1000.f)) + suffixes[idx];
+}
+
 inline void _doCallstack(std::string& output,
 						 const Profiler::callstack_t& v) {
 	using namespace std::string_literals;
 
 	output += "Traceback:\n";
 	for (int i = v.size() - 2; i > 0; --i) {
-		std::string name = v[i].funcName;
+		std::string name = v[i].site->funcName;
 		if (Profiler::verbosity())
-			name = v[i].richFuncName;
+			name = v[i].site->richFuncName;
 
-		output += "  File \""s + v[i].file.substr(v[i].file.find_last_of('\\') + 1) + "\", line " + v[i].line + ", in " + name + "\n";
+		output += "  File \""s + v[i].site->fileName() + "\", line " + std::to_string(v[i].site->line) + ", in " + name + "\n";
 	}
 }
 
@@ -33,94 +466,159 @@ std::string formatFrame(const StackFrame& frame, const timepoint_t& now) {
 	std::string buffer;
 	buffer.reserve(10000);
 
-	if (Profiler::target().size()) {
-		auto destructorTime = now - frame.callTime;
-		auto _traceback = Profiler::traceback();
-		auto _verbosity = Profiler::verbosity();
-
+	auto destructorTime = now - frame.callTime;
+	auto _traceback = Profiler::traceback();
+	auto _verbosity = Profiler::verbosity();
 
-		std::string name = frame.funcName;
-		if (_verbosity)
-			name = frame.richFuncName;
 
-		buffer += "File \""s + frame.file.substr(frame.file.find_last_of('\\') + 1)
-			+ "\", line " + frame.line + ", in "
-			+ name;
+	std::string name = frame.site->funcName;
+	if (_verbosity)
+		name = frame.site->richFuncName;
 
-		buffer += " (Executed in ";
+	buffer += "File \""s + frame.site->fileName()
+		+ "\", line " + std::to_string(frame.site->line) + ", in "
+		+ name;
 
-		static const char* suffixes[] = {
-			"ns", "us", "ms", "s"
-		};
+	buffer += " (Executed in ";
+	buffer += formatDuration(chrono::duration_cast<chrono::nanoseconds>(destructorTime).count()) + ").\n";
 
-		long long counter = chrono::duration_cast<chrono::nanoseconds>(destructorTime).count();
-		long long bottom = 0;
-		int idx = 0;
+	if (_traceback && Profiler::stack().size() > 2) {
+		_doCallstack(buffer, Profiler::stack());
+	}
 
-		while (counter > 1000 && idx < 3) {
-			idx++;
-			bottom = counter % 1000;
-			counter /= 1000;
-		}
+	if (_traceback)
+		buffer += "\n";
 
-		buffer += std::to_string(counter + (bottom / 1000.f)) + suffixes[idx] + ").\n";
-		
-		if (_traceback && Profiler::stack().size() > 2) {
-			_doCallstack(buffer, Profiler::stack());
-		}
+	return buffer;
+}
 
-		if (_traceback)
-			buffer += "\n";
+std::string _jsonEscape(const char* str) {
+	std::string escaped;
+	for (; *str; ++str) {
+		if (*str == '"' || *str == '\\')
+			escaped += '\\';
+		escaped += *str;
 	}
+	return escaped;
+}
 
-	return buffer;
+/*
+	Formats a frame as a Chrome trace-event complete event. Every event is
+	prefixed with a comma, the header of the file already contains
+	the process name metadata event, so the array stays valid JSON.
+*/
+std::string formatEvent(const StackFrame& frame, const timepoint_t& now) {
+	//Frames entered before tracing started are cut off at its start
+	timepoint_t traceStart = Profiler::traceStart;
+	auto callTime = std::max(frame.callTime, traceStart);
+	auto start = chrono::duration<double, std::micro>(callTime - traceStart).count();
+	auto duration = chrono::duration<double, std::micro>(now - callTime).count();
+
+	const char* name = Profiler::verbosity() ? frame.site->richFuncName : frame.site->funcName;
+
+	char times[96];
+	snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,",
+			 start, duration, Profiler::threadId());
+
+	return ",\n{\"name\":\"" + _jsonEscape(name) + "\",\"cat\":\"" + _jsonEscape(frame.site->fileName().c_str())
+		+ "\",\"ph\":\"X\"," + times + "\"args\":{\"line\":" + std::to_string(frame.site->line) + "}}";
 }
 
-void partialDump() {
+/*
+	Writes the buffer into the target file and clears it. When rewrite is true,
+	the file is truncated even if something was already written into it.
+*/
+void partialDump(std::string& buffer, bool rewrite = false) {
+	std::lock_guard<std::mutex> guard{ _fileMutex() };
 	if (!Profiler::target().size())	return;
 
-	std::ofstream f{ Profiler::target() };
-	Profiler::buffer.shrink_to_fit();
-	f.write(&Profiler::buffer[0], Profiler::buffer.size());
+	if (rewrite)	_fileStarted = false;
+
+	auto openMode = _fileStarted ? std::ios_base::app : std::ios_base::trunc;
+	std::ofstream f{ Profiler::target(), std::ios_base::out | openMode };
+
+	if (!_fileStarted && Profiler::mode() == ProfileMode::Trace) {
+		f << "{\"traceEvents\":[\n"
+			"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"chess\"}}";
+	}
+
+	f.write(buffer.data(), buffer.size());
+	buffer.clear();
+	_fileStarted = true;
+}
+
+/*
+	Takes the pending output of every thread, in order in which the threads
+	first entered a profiled scope.
+*/
+std::string _collectBuffers(std::vector<std::shared_ptr<ThreadProfile>>& threads) {
+	std::string collected;
+
+	std::lock_guard<std::mutex> guard{ _threadsMutex() };
+	for (auto& profile : threads) {
+		std::lock_guard<std::mutex> profileGuard{ profile->lock };
+		collected += profile->buffer;
+		profile->buffer.clear();
+	}
+
+	return collected;
 }
 
 void dumpBuffer(bool exiting) {
 	if (!Profiler::target().size())	return;
 
-	auto now = chrono::high_resolution_clock::now().time_since_epoch();
+	//The writer drains whatever is left and finishes the file on its own
+	if (Profiler::mode() == ProfileMode::Binary) {
+		_writer().stop();
+		return;
+	}
 
-	//Collect unclosed stack values
-	if (exiting)
-		Profiler::buffer += "\n\nProgram exiting. Remaining stack:\n\n";
-		while (Profiler::callstack.size() > 1) {
-			Profiler::buffer += formatFrame(Profiler::callstack.back(), now);
-			Profiler::callstack.pop_back();
-		}
+	//Anything besides the stacks would break tools reading the file
+	if (Profiler::mode() == ProfileMode::Folded) {
+		auto stacks = Profiler::folded();
+		partialDump(stacks, true);
+		return;
+	}
 
-	std::ofstream f{ Profiler::target() };
-	Profiler::buffer.shrink_to_fit();
-	f.write(&Profiler::buffer[0], Profiler::buffer.size());
-	std::string totalSpentTimer = "\n\n";
-	totalSpentTimer += "Total time spent composing this file: ";
+	auto now = chrono::high_resolution_clock::now().time_since_epoch();
+	auto spent = formatDuration(chrono::duration_cast<chrono::nanoseconds>(Profiler::spent()).count());
 
-	static const char* suffixes[] = {
-		"ns", "us", "ms", "s"
-	};
+	std::string buffer;
+	bool aggregate = Profiler::mode() == ProfileMode::Aggregate;
 
-	long long counter = chrono::duration_cast<chrono::nanoseconds>(Profiler::spent()).count();
-	long long bottom = 0;
-	int idx = 0;
+	if (aggregate) {
+		//The table replaces whatever was written before
+		buffer = Profiler::summary();
+	}
+	else {
+		buffer = _collectBuffers(Profiler::threads());
 
-	while (counter > 1000 && idx < 3) {
-		idx++;
-		bottom = counter % 1000;
-		counter /= 1000;
+		//Collect unclosed stack values of the thread that is exiting
+		if (exiting) {
+			auto& callstack = Profiler::local().callstack;
+			if (Profiler::mode() == ProfileMode::Text)
+				buffer += "\n\nProgram exiting. Remaining stack:\n\n";
+			while (callstack.size() > 1) {
+				if (Profiler::mode() == ProfileMode::Trace)
+					buffer += formatEvent(callstack.back(), now);
+				else
+					buffer += formatFrame(callstack.back(), now);
+				callstack.pop_back();
+			}
+		}
 	}
 
-	totalSpentTimer += std::to_string(counter + (bottom / 1000.f)) + suffixes[idx] + ".\n";
+	if (Profiler::mode() == ProfileMode::Trace) {
+		buffer += "\n],\n\"otherData\":{\"profilerOverhead\":\"" + spent + "\"}}\n";
+	}
+	else {
+		buffer += "\n\n";
+		buffer += "Total time spent composing this file: " + spent + ".\n";
+		if (!aggregate && Profiler::sampling() > 1)
+			buffer += "Sampled every " + std::to_string(Profiler::sampling()) + " calls of every function.\n";
+	}
 
-	totalSpentTimer.shrink_to_fit();
-	f.write(&totalSpentTimer[0], totalSpentTimer.size());
+	partialDump(buffer, aggregate);
 }
 
 void dumpBuffer() {
@@ -129,34 +627,510 @@ void dumpBuffer() {
 
 inline auto atExitRegister = std::atexit(dumpBuffer);
 
-Profiler::Profiler(std::string func, std::string prettyFunc, std::string file, std::string line)
+Profiler::Profiler(const ProfileSite& site)
 {
-	Profiler::callstack.emplace_back(func, prettyFunc, file, line, chrono::high_resolution_clock::now().time_since_epoch());
+	recorded = site.enabled.load(std::memory_order_relaxed);
+	if (!recorded)	return;
+
+	auto& profile = local();
+	bool folded = mode() == ProfileMode::Folded;
+
+	//A path that misses a skipped scope never happened, so its whole subtree is skipped
+	if (folded && profile.sampledOut) {
+		recorded = false;
+		sampledOut = true;
+		++profile.sampledOut;
+		return;
+	}
+
+	if (auto rate = sampling(); rate > 1) {
+		if (profile.entries.size() <= site.id)
+			profile.entries.resize(site.id + 1);
+		recorded = profile.entries[site.id]++ % rate == 0;
+		if (!recorded) {
+			sampledOut = folded;
+			profile.sampledOut += folded;
+			return;
+		}
+	}
+
+	uint32_t node = folded ? _enterPath(profile, site) : 0;
+	profile.callstack.emplace_back(&site, chrono::high_resolution_clock::now().time_since_epoch(), node);
+
+	//Read last, so the rest of the Profiler is not counted into the scope
+	if (counters() && mode() == ProfileMode::Aggregate)
+		_readCounters(profile, profile.callstack.back().counts);
 }
 
 Profiler::~Profiler()
 {
 	using namespace std::string_literals;
 
+	if (sampledOut)
+		--local().sampledOut;
+	if (!recorded)	return;
+
+	auto& profile = local();
+	auto& callstack = profile.callstack;
 	if (callstack.size() <= 1)	return;
-	
+
 	auto now = chrono::high_resolution_clock::now().time_since_epoch();
-	if (targetFile.size()) {
-		buffer += formatFrame(callstack.back(), now);
-		if (buffer.size() > 1024 * 1024) {
-			partialDump();
-			buffer.clear();
+
+	counters_t counts;
+	bool counting = counters() && mode() == ProfileMode::Aggregate;
+	if (counting)
+		_readCounters(profile, counts);
+
+	if (active.load(std::memory_order_relaxed) && mode() == ProfileMode::Binary) {
+		auto& frame = callstack.back();
+		auto ring = profile.ring.load(std::memory_order_relaxed);
+		if (!ring) {
+			ring = new EventRing();
+			profile.ring.store(ring, std::memory_order_release);
+		}
+
+		timepoint_t start = traceStart;
+		ring->push({
+			static_cast<uint32_t>(frame.site->id),
+			static_cast<uint32_t>(profile.id),
+			chrono::duration_cast<chrono::nanoseconds>(std::max(frame.callTime - start, timepoint_t{})).count(),
+			chrono::duration_cast<chrono::nanoseconds>(now - frame.callTime).count()
+		});
+
+		auto spent = chrono::high_resolution_clock::now().time_since_epoch() - now;
+		profile.totalSpent.fetch_add(chrono::duration_cast<chrono::nanoseconds>(spent).count(), std::memory_order_relaxed);
+	}
+	else if (active.load(std::memory_order_relaxed)) {
+		auto& frame = callstack.back();
+		std::string full;
+
+		{
+			std::lock_guard<std::mutex> guard{ profile.lock };
+			if (mode() == ProfileMode::Aggregate) {
+				if (profile.stats.size() <= frame.site->id)
+					profile.stats.resize(frame.site->id + 1);
+				auto& stats = profile.stats[frame.site->id];
+				stats.add(chrono::duration_cast<chrono::nanoseconds>(now - frame.callTime).count());
+
+				//Frames entered before counting started have no starting values
+				if (counting && frame.counts != counters_t{}) {
+					for (size_t idx = 0; idx < counts.size(); ++idx)
+						stats.hardware[idx] += counts[idx] - frame.counts[idx];
+				}
+			}
+			else if (mode() == ProfileMode::Folded) {
+				//Frames entered before the mode was switched have no path
+				if (frame.node) {
+					auto spentHere = chrono::duration_cast<chrono::nanoseconds>(now - frame.callTime).count();
+					auto& node = profile.paths[frame.node];
+					node.inclusive += spentHere;
+					profile.paths[node.parent].children += spentHere;
+				}
+			}
+			else {
+				if (mode() == ProfileMode::Trace)
+					profile.buffer += formatEvent(frame, now);
+				else
+					profile.buffer += formatFrame(frame, now);
+
+				if (profile.buffer.size() > 1024 * 1024)
+					full.swap(profile.buffer);
+			}
 		}
+
+		//Write outside of the lock, so merging threads never wait for the disk
+		if (full.size())
+			partialDump(full);
+
+		auto spent = chrono::high_resolution_clock::now().time_since_epoch() - now;
+		profile.totalSpent.fetch_add(chrono::duration_cast<chrono::nanoseconds>(spent).count(), std::memory_order_relaxed);
 	}
 
 	callstack.pop_back();
-	totalSpent += chrono::high_resolution_clock::now().time_since_epoch() - now;
+}
+
+uint32_t Profiler::_enterPath(ThreadProfile& profile, const ProfileSite& site)
+{
+	uint32_t parent = profile.callstack.back().node;
+	uint64_t key = static_cast<uint64_t>(parent) << 32 | site.id;
+
+	std::lock_guard<std::mutex> guard{ profile.lock };
+	auto [it, created] = profile.pathIndex.try_emplace(key, static_cast<uint32_t>(profile.paths.size()));
+	if (created)
+		profile.paths.emplace_back(&site, parent);
+	return it->second;
+}
+
+std::vector<const ProfileSite*>& Profiler::sites()
+{
+	//Never destroyed, sites have to be reachable while dumping at exit
+	static auto* all = new std::vector<const ProfileSite*>();
+	return *all;
+}
+
+ThreadProfile& Profiler::local()
+{
+	//Plain pointer, the profile is owned by threads() until the thread exits
+	thread_local ThreadProfile* profile = nullptr;
+	thread_local bool exited = false;
+
+	/*
+		Destroyed when the thread exits, so the profile can hand over what it holds.
+	*/
+	struct Owner {
+		~Owner() {
+			exited = true;
+			if (_threadExited(*profile))
+				profile = nullptr;
+		}
+	};
+
+	if (profile)	return *profile;
+
+	auto created = std::make_shared<ThreadProfile>(threadId());
+	{
+		std::lock_guard<std::mutex> guard{ _threadsMutex() };
+		threads().push_back(created);
+	}
+	profile = created.get();
+
+	//Scopes entered while the thread exits get a profile that is kept until the process ends
+	if (!exited) {
+		thread_local Owner owner;
+	}
+
+	return *profile;
+}
+
+std::vector<std::shared_ptr<ThreadProfile>>& Profiler::threads()
+{
+	static auto* all = new std::vector<std::shared_ptr<ThreadProfile>>{ std::make_shared<ThreadProfile>(0) };
+	return *all;
+}
+
+bool Profiler::_threadExited(ThreadProfile& profile)
+{
+	std::shared_ptr<ThreadProfile> dropped;
+	std::string full;
+
+	{
+		//The ring is taken out under the lock, so the writer finds it in exactly one place
+		std::lock_guard<std::mutex> guard{ _threadsMutex() };
+		if (auto ring = profile.ring.exchange(nullptr))
+			_finishedRings().push_back(ring);
+
+		//A thread exiting inside of a scope is the one ending the process, its stack is dumped at exit
+		if (profile.callstack.size() > 1)	return false;
+
+		//What the counters counted is already in the stats, the descriptors are not kept until the profile goes
+		profile.hardware.close();
+
+		auto& all = threads();
+		auto& retired = *all.front();
+		std::scoped_lock locks{ retired.lock, profile.lock };
+
+		retired.buffer += profile.buffer;
+		if (retired.buffer.size() > 1024 * 1024)
+			full.swap(retired.buffer);
+
+		if (retired.stats.size() < profile.stats.size())
+			retired.stats.resize(profile.stats.size());
+		for (size_t idx = 0; idx < profile.stats.size(); ++idx)
+			retired.stats[idx].merge(profile.stats[idx]);
+
+		//Parents always come before their children, so they are already mapped
+		std::vector<uint32_t> mapped(profile.paths.size(), 0);
+		for (size_t idx = 1; idx < profile.paths.size(); ++idx) {
+			auto& node = profile.paths[idx];
+			uint32_t parent = mapped[node.parent];
+			uint64_t key = static_cast<uint64_t>(parent) << 32 | node.site->id;
+
+			auto [it, created] = retired.pathIndex.try_emplace(key, static_cast<uint32_t>(retired.paths.size()));
+			if (created)
+				retired.paths.emplace_back(node.site, parent);
+
+			mapped[idx] = it->second;
+			retired.paths[it->second].inclusive += node.inclusive;
+			retired.paths[it->second].children += node.children;
+		}
+
+		retired.totalSpent += profile.totalSpent.load(std::memory_order_relaxed);
+
+		auto at = std::find_if(all.begin(), all.end(), [&profile](auto& other) {
+			return other.get() == &profile;
+		});
+		dropped = std::move(*at);
+		all.erase(at);
+	}
+
+	//Written outside of the locks, same as the buffers of running threads
+	if (full.size())
+		partialDump(full);
+
+	return true;
+}
+
+int Profiler::threadId()
+{
+	static std::atomic<int> counter = 0;
+	thread_local int id = ++counter;
+	return id;
+}
+
+/*
+	Drops everything collected by all threads so far.
+*/
+void _resetThreads(std::vector<std::shared_ptr<ThreadProfile>>& threads) {
+	std::lock_guard<std::mutex> guard{ _threadsMutex() };
+	for (auto& profile : threads) {
+		std::lock_guard<std::mutex> profileGuard{ profile->lock };
+		profile->buffer.clear();
+		profile->stats.clear();
+		for (auto& node : profile->paths)
+			node.inclusive = node.children = 0;
+		profile->totalSpent = 0;
+	}
 }
 
 void Profiler::target(std::string targetFil)
+{
+	target(std::move(targetFil), mode());
+}
+
+void Profiler::target(std::string targetFil, ProfileMode newMode)
 {
 	dumpBuffer(false);
-	targetFile = targetFil;
-	buffer = "";
+
+	//The trace of the old file is finished before the next one starts
+	if (mode() == ProfileMode::Binary)
+		_writer().stop();
+
+	{
+		std::lock_guard<std::mutex> guard{ _fileMutex() };
+		targetFile = targetFil;
+		_fileStarted = false;
+	}
+
+	_mode = newMode;
+	_resetThreads(threads());
+	traceStart = chrono::high_resolution_clock::now().time_since_epoch();
+	active = targetFil.size() > 0;
+	_refreshSites();
+
+	if (active && newMode == ProfileMode::Binary)
+		_writer().start(targetFil, threads());
+}
+
+void Profiler::mode(ProfileMode newMode)
+{
+	if (mode() == ProfileMode::Binary && newMode != ProfileMode::Binary)
+		_writer().stop();
+
+	_mode = newMode;
+	_resetThreads(threads());
+
+	if (active && newMode == ProfileMode::Binary)
+		_writer().start(targetFile, threads());
+}
+
+void Profiler::_refreshSites()
+{
+	std::lock_guard<std::mutex> guard{ _sitesMutex() };
+	bool on = active.load();
+	for (auto site : sites())
+		const_cast<ProfileSite*>(site)->enabled.store(on && _passesFilters(*site), std::memory_order_relaxed);
+}
+
+void Profiler::sampling(int everyNth)
+{
+	_sampling = std::max(everyNth, 1);
+}
+
+void Profiler::include(std::string pattern)
+{
+	{
+		std::lock_guard<std::mutex> guard{ _sitesMutex() };
+		_includes().push_back(std::move(pattern));
+	}
+	_refreshSites();
+}
+
+void Profiler::exclude(std::string pattern)
+{
+	{
+		std::lock_guard<std::mutex> guard{ _sitesMutex() };
+		_excludes().push_back(std::move(pattern));
+	}
+	_refreshSites();
+}
+
+void Profiler::clearFilters()
+{
+	{
+		std::lock_guard<std::mutex> guard{ _sitesMutex() };
+		_includes().clear();
+		_excludes().clear();
+	}
+	_refreshSites();
+}
+
+timepoint_t Profiler::spent()
+{
+	long long total = 0;
+
+	std::lock_guard<std::mutex> guard{ _threadsMutex() };
+	for (auto& profile : threads())
+		total += profile->totalSpent.load(std::memory_order_relaxed);
+
+	return chrono::duration_cast<timepoint_t>(chrono::nanoseconds(total));
 }
 
+void Profiler::flush()
+{
+	if (!target().size())	return;
+
+	if (mode() == ProfileMode::Binary) {
+		_writer().poke();
+		return;
+	}
+
+	if (mode() == ProfileMode::Aggregate) {
+		auto table = summary();
+		partialDump(table, true);
+	}
+	else if (mode() == ProfileMode::Folded) {
+		auto stacks = folded();
+		partialDump(stacks, true);
+	}
+	else {
+		auto collected = _collectBuffers(threads());
+		partialDump(collected);
+	}
+}
+
+std::string Profiler::summary()
+{
+	std::vector<SiteStats> stats;
+
+	{
+		std::lock_guard<std::mutex> guard{ _threadsMutex() };
+		for (auto& profile : threads()) {
+			std::lock_guard<std::mutex> profileGuard{ profile->lock };
+			if (stats.size() < profile->stats.size())
+				stats.resize(profile->stats.size());
+			for (size_t idx = 0; idx < profile->stats.size(); ++idx)
+				stats[idx].merge(profile->stats[idx]);
+		}
+	}
+
+	std::vector<const ProfileSite*> reached;
+	{
+		std::lock_guard<std::mutex> guard{ _sitesMutex() };
+		reached = sites();
+	}
+
+	std::vector<size_t> order(stats.size());
+	std::iota(order.begin(), order.end(), 0);
+	order.erase(std::remove_if(order.begin(), order.end(), [&](size_t idx) {
+		return !stats[idx].count;
+	}), order.end());
+
+	if (!order.size())	return "";
+
+	std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+		return stats[lhs].total > stats[rhs].total;
+	});
+
+	static auto column = [](std::string s, size_t width) {
+		if (s.size() < width)
+			s.insert(0, width - s.size(), ' ');
+		return s + " ";
+	};
+
+	auto event = [](const SiteStats& s, HardwareEvent e) {
+		return s.hardware[static_cast<size_t>(e)];
+	};
+
+	bool hardware = std::any_of(order.begin(), order.end(), [&](size_t idx) {
+		return event(stats[idx], HardwareEvent::Cycles) || event(stats[idx], HardwareEvent::Instructions);
+	});
+
+	std::string table;
+	if (sampling() > 1)
+		table += "Sampled every " + std::to_string(sampling()) + " calls of every function.\n";
+	if (counters() && !hardware)
+		table += "Hardware counters are not available, showing timings only.\n";
+	table += column("Calls", 12) + column("Total", 14) + column("Average", 14)
+		+ column("Min", 14) + column("Max", 14) + column("p50", 14)
+		+ column("p99", 14);
+	if (hardware)
+		table += column("IPC", 6) + column("Cycles/call", 14) + column("Cache miss/call", 16)
+			+ column("Branch miss/call", 17);
+	table += " Function\n";
+
+	for (auto idx : order) {
+		auto& s = stats[idx];
+		auto& site = *reached[idx];
+
+		std::string name = verbosity() ? site.richFuncName : site.funcName;
+
+		table += column(std::to_string(s.count), 12)
+			+ column(formatDuration(s.total), 14)
+			+ column(formatDuration(s.total / static_cast<long long>(s.count)), 14)
+			+ column(formatDuration(s.min), 14)
+			+ column(formatDuration(s.max), 14)
+			+ column(formatDuration(s.percentile(0.5)), 14)
+			+ column(formatDuration(s.percentile(0.99)), 14);
+
+		if (hardware) {
+			auto perCall = [&](HardwareEvent e) {
+				char formatted[32];
+				snprintf(formatted, sizeof(formatted), "%.1f", static_cast<double>(event(s, e)) / s.count);
+				return std::string{ formatted };
+			};
+
+			char ipc[16] = "-";
+			if (event(s, HardwareEvent::Cycles))
+				snprintf(ipc, sizeof(ipc), "%.2f", static_cast<double>(event(s, HardwareEvent::Instructions)) / event(s, HardwareEvent::Cycles));
+
+			table += column(ipc, 6) + column(perCall(HardwareEvent::Cycles), 14)
+				+ column(perCall(HardwareEvent::CacheMisses), 16)
+				+ column(perCall(HardwareEvent::BranchMisses), 17);
+		}
+
+		table += " " + name + " (" + site.fileName()
+			+ ", line " + std::to_string(site.line) + ")\n";
+	}
+
+	return table;
+}
+
+std::string Profiler::folded()
+{
+	std::map<std::string, long long> stacks;
+	bool rich = verbosity();
+
+	std::lock_guard<std::mutex> guard{ _threadsMutex() };
+	for (auto& profile : threads()) {
+		std::lock_guard<std::mutex> profileGuard{ profile->lock };
+		auto& paths = profile->paths;
+
+		for (size_t idx = 1; idx < paths.size(); ++idx) {
+			auto self = paths[idx].inclusive - paths[idx].children;
+			if (self <= 0)	continue;
+
+			std::string stack;
+			for (auto at = idx; at; at = paths[at].parent) {
+				auto site = paths[at].site;
+				stack.insert(0, std::string{ rich ? site->richFuncName : site->funcName } + (stack.size() ? ";" : ""));
+			}
+			stacks[stack] += self;
+		}
+	}
+
+	std::string output;
+	for (auto& [stack, ns] : stacks)
+		output += stack + " " + std::to_string(ns) + "\n";
+
+	return output;
+}
@@ -0,0 +1,409 @@
+/*
+	Universal Chess Interface front end of the engine, for GUIs and
+	tournament managers such as cutechess-cli or fastchess.
+
+	Usage: uci
+
+	Reads commands from stdin and answers on stdout, one per line. Supports
+	uci, isready, ucinewgame, setoption, position, go, stop, ponderhit and quit.
+	Options are Hash in megabytes, Threads, MultiPV, Move Overhead in milliseconds
+	and EvalFile, a network to evaluate with, <empty> for the hand-written evaluation.
+*/
+
+#include "../../include/ai/nnue.hpp"
+#include "../../include/ai/search.hpp"
+#include "../../include/ai/transposition.hpp"
+#include "../../include/boards/chess.hpp"
+#include "../../include/stringutil.hpp"
+#include "../../include/ui/conactions.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char* startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+/**
+	State of the engine between commands, the board of the last position
+	command and the search running on it, if any.
+*/
+class UciEngine {
+	ChessBoard board;
+	std::vector<uint64_t> gameHashes;	/**< Positions played before the board, so the search sees repetitions. */
+	bool validPosition = true;			/**< False after a position command with an illegal move, nothing is searched. */
+	TranspositionTable table{ 16 };
+	std::unique_ptr<Network> network;
+	int threads = 1;
+	int multiPv = 1;
+	int64_t moveOverhead = 30;
+
+	Search search{ &table };
+	std::thread searcher;
+
+	/*
+		With go infinite or ponder, the best move must not be sent before
+		stop or ponderhit, even if the search finished on its own.
+	*/
+	std::mutex waitMutex;
+	std::condition_variable waitChanged;
+	bool waiting = false;
+
+	std::mutex outputMutex;
+
+	void _send(const std::string& line);
+	void _stopSearch();
+	void _setOption(const std::vector<std::string_view>& args);
+	void _position(const std::vector<std::string_view>& args);
+	void _go(const std::vector<std::string_view>& args);
+	void _report(const SearchResult& result);
+public:
+	UciEngine() {
+		board.loadFEN(startFen);
+	}
+
+	~UciEngine() {
+		_stopSearch();
+	}
+
+	/**
+		Handle a single line of input.
+
+		\return False once the engine should quit.
+	*/
+	bool handle(const std::string& line);
+};
+
+/*
+	Find a move in coordinate notation among the legal moves of the position.
+*/
+static Move _parseMove(SearchPosition& position, std::string_view text)
+{
+	MoveList legal;
+	position.generateLegal(legal);
+	for (auto& move : legal)
+		if (move.toString() == text)
+			return move;
+
+	return {};
+}
+
+/*
+	Write the position in Forsyth-Edwards Notation. The fullmove number is
+	not kept by the position, so it is always 1.
+*/
+static std::string _toFen(const SearchPosition& position)
+{
+	std::string fen;
+	for (int rank = 7; rank >= 0; --rank) {
+		int empty = 0;
+		for (int file = 0; file < 8; ++file) {
+			auto piece = position.at(static_cast<square_t>(rank * 8 + file));
+			if (!piece) {
+				++empty;
+				continue;
+			}
+
+			if (empty)	fen += static_cast<char>('0' + empty);
+			empty = 0;
+
+			char c = typeToCharRaw(pieceType(piece));
+			fen += pieceColor(piece) == Color::White ? c : static_cast<char>(std::tolower(c));
+		}
+
+		if (empty)	fen += static_cast<char>('0' + empty);
+		if (rank)	fen += '/';
+	}
+
+	fen += position.sideToMove() == Color::White ? " w " : " b ";
+
+	auto rights = position.castlingRights();
+	if (rights & SearchPosition::WhiteKingSide)		fen += 'K';
+	if (rights & SearchPosition::WhiteQueenSide)	fen += 'Q';
+	if (rights & SearchPosition::BlackKingSide)		fen += 'k';
+	if (rights & SearchPosition::BlackQueenSide)	fen += 'q';
+	if (!rights)	fen += '-';
+
+	auto enPassant = position.enPassantSquare();
+	fen += " " + (enPassant < 0 ? std::string{ "-" } : positionToString(toPosition(enPassant)));
+	return fen + " " + std::to_string(position.halfmoveClock()) + " 1";
+}
+
+/*
+	Score as UCI wants it, centipawns or mate in moves, negative when mated.
+*/
+static std::string _scoreToUci(int score)
+{
+	if (std::abs(score) >= Search::mateScore - Search::maxPly) {
+		int moves = (Search::mateScore - std::abs(score) + 1) / 2;
+		return "mate " + std::to_string(score > 0 ? moves : -moves);
+	}
+
+	return "cp " + std::to_string(score);
+}
+
+void UciEngine::_send(const std::string& line)
+{
+	std::lock_guard<std::mutex> lock(outputMutex);
+	std::cout << line << std::endl;
+}
+
+void UciEngine::_stopSearch()
+{
+	if (!searcher.joinable())	return;
+
+	search.stop();
+	{
+		std::lock_guard<std::mutex> lock(waitMutex);
+		waiting = false;
+	}
+	waitChanged.notify_all();
+	searcher.join();
+}
+
+void UciEngine::_setOption(const std::vector<std::string_view>& args)
+{
+	//setoption name NAME WITH SPACES [value VALUE]
+	auto nameAt = std::find(args.begin(), args.end(), "name");
+	auto valueAt = std::find(args.begin(), args.end(), "value");
+	if (nameAt == args.end())	return;
+
+	std::vector<std::string_view> nameWords(nameAt + 1, valueAt);
+	std::vector<std::string_view> valueWords;
+	if (valueAt != args.end())
+		valueWords.assign(valueAt + 1, args.end());
+
+	auto name = join(nameWords, " ");
+	auto value = join(valueWords, " ");
+	std::transform(name.begin(), name.end(), name.begin(), [](char c) {
+		return static_cast<char>(std::tolower(c));
+	});
+
+	try {
+		if (name == "hash")
+			table.resize(std::clamp<size_t>(std::stoul(value), 1, 65536));
+		else if (name == "threads")
+			threads = std::clamp(std::stoi(value), 1, 1024);
+		else if (name == "multipv")
+			multiPv = std::clamp(std::stoi(value), 1, 256);
+		else if (name == "move overhead")
+			moveOverhead = std::clamp<int64_t>(std::stoll(value), 0, 5000);
+		else if (name == "evalfile") {
+			if (value.empty() || value == "<empty>") {
+				network.reset();
+				return;
+			}
+
+			auto loaded = std::make_unique<Network>();
+			if (!loaded->load(value)) {
+				_send("info string cannot load network " + value);
+				return;
+			}
+			network = std::move(loaded);
+			_send("info string loaded network " + value + " using " + Network::instructionSet());
+		}
+	} catch (std::exception&) {
+		_send("info string invalid value for " + name);
+	}
+}
+
+void UciEngine::_position(const std::vector<std::string_view>& args)
+{
+	//position startpos|fen FEN [moves MOVE...]
+	auto movesAt = std::find(args.begin(), args.end(), "moves");
+	gameHashes.clear();
+	validPosition = true;
+
+	if (args.size() >= 2 && args[1] == "fen") {
+		std::vector<std::string_view> fenWords(args.begin() + 2, movesAt);
+		if (!board.loadFEN(join(fenWords, " "))) {
+			_send("info string invalid fen, using the starting position");
+		}
+	}
+	else {
+		board.loadFEN(startFen);
+	}
+
+	if (movesAt == args.end())	return;
+
+	//The moves are played on a position, which keeps the hash of every position
+	//they pass and, unlike the board, never ends the game on a repetition
+	SearchPosition position;
+	if (!position.load(board))	return;
+
+	for (auto it = movesAt + 1; it != args.end(); ++it) {
+		auto move = _parseMove(position, *it);
+		if (move.isNone()) {
+			_send("info string illegal move " + std::string{ *it } + ", not searching until the next position");
+			validPosition = false;
+			return;
+		}
+
+		gameHashes.push_back(position.hash());
+		position.makeMove(move);
+	}
+
+	board.loadFEN(_toFen(position));
+}
+
+void UciEngine::_report(const SearchResult& result)
+{
+	auto milliseconds = static_cast<uint64_t>(result.seconds * 1000);
+	auto hashfull = table.permilleFull();
+
+	for (size_t idx = 0; idx < result.lines.size(); ++idx) {
+		auto& pvLine = result.lines[idx];
+		std::string line = "info depth " + std::to_string(result.depth);
+		if (multiPv > 1)
+			line += " multipv " + std::to_string(idx + 1);
+		line += " score " + _scoreToUci(pvLine.score)
+			+ " nodes " + std::to_string(result.nodes)
+			+ " nps " + std::to_string(static_cast<uint64_t>(result.nodesPerSecond()))
+			+ " time " + std::to_string(milliseconds)
+			+ " hashfull " + std::to_string(hashfull)
+			+ " pv";
+		for (auto& move : pvLine.pv)
+			line += " " + move.toString();
+		_send(line);
+	}
+}
+
+void UciEngine::_go(const std::vector<std::string_view>& args)
+{
+	_stopSearch();
+
+	//A move list played only partly would search the wrong position, maybe for the wrong side
+	if (!validPosition) {
+		_send("bestmove 0000");
+		return;
+	}
+
+	SearchLimits limits;
+	limits.threads = threads;
+	limits.multiPv = multiPv;
+	limits.clock.overhead = moveOverhead;
+	bool white = board.getPlayingColor() != Color::Black;
+	bool infinite = false;
+
+	for (size_t idx = 1; idx < args.size(); ++idx) {
+		auto& arg = args[idx];
+		if (arg == "infinite" || arg == "ponder") {
+			infinite = true;
+			continue;
+		}
+		if (idx + 1 >= args.size())	break;
+
+		long long value = 0;
+		try {
+			value = std::stoll(std::string{ args[idx + 1] });
+		} catch (std::exception&) {
+			continue;
+		}
+		++idx;
+
+		//Only the clock of the player to move matters
+		if (arg == (white ? "wtime" : "btime"))
+			limits.clock.time = std::max(value, 1LL);
+		else if (arg == (white ? "winc" : "binc"))
+			limits.clock.increment = std::max(value, 0LL);
+		else if (arg == "movestogo")
+			limits.clock.movesToGo = static_cast<int>(std::clamp(value, 0LL, 1000LL));
+		else if (arg == "depth")
+			limits.depth = static_cast<int>(std::clamp(value, 1LL, 64LL));
+		else if (arg == "nodes")
+			limits.nodes = static_cast<uint64_t>(std::max(value, 1LL));
+		else if (arg == "movetime")
+			limits.time = std::max<int64_t>(value - moveOverhead, 1);
+	}
+
+	//Pondering and infinite searches ignore the clock, they run until told to stop
+	if (infinite)
+		limits.clock = {};
+
+	waiting = infinite;
+	search.useNetwork(network.get());
+
+	//Copies, the next position command may come before the search is done
+	auto searched = board.clone();
+	searcher = std::thread([this, searched, limits, hashes = gameHashes]() {
+		auto result = search.run(*searched, limits, [this](const SearchResult& result) {
+			_report(result);
+		}, hashes);
+
+		{
+			std::unique_lock<std::mutex> lock(waitMutex);
+			waitChanged.wait(lock, [this]() { return !waiting; });
+		}
+
+		std::string line = "bestmove " + result.best.toString();
+		if (result.pv.size() >= 2)
+			line += " ponder " + result.pv[1].toString();
+		_send(line);
+	});
+}
+
+bool UciEngine::handle(const std::string& line)
+{
+	auto args = split(std::string_view{ line });
+	if (args.empty())	return true;
+
+	auto& command = args.front();
+	if (command == "uci") {
+		_send("id name C++ Chess");
+		_send("id author Eduard Lahl");
+		_send("option name Hash type spin default 16 min 1 max 65536");
+		_send("option name Threads type spin default 1 min 1 max 1024");
+		_send("option name MultiPV type spin default 1 min 1 max 256");
+		_send("option name Move Overhead type spin default 30 min 0 max 5000");
+		_send("option name EvalFile type string default <empty>");
+		_send("uciok");
+	}
+	else if (command == "isready") {
+		_send("readyok");
+	}
+	else if (command == "ucinewgame") {
+		_stopSearch();
+		table.clear();
+	}
+	else if (command == "setoption") {
+		//The table cannot be resized while threads use it
+		_stopSearch();
+		_setOption(args);
+	}
+	else if (command == "position") {
+		_position(args);
+	}
+	else if (command == "go") {
+		_go(args);
+	}
+	else if (command == "stop") {
+		_stopSearch();
+	}
+	else if (command == "ponderhit") {
+		//The ponder search has no clock, the move is played as soon as it is done
+		_stopSearch();
+	}
+	else if (command == "quit") {
+		return false;
+	}
+
+	return true;
+}
+
+int main()
+{
+	//Only the streams are used, so they need not stay in sync with stdio
+	std::ios::sync_with_stdio(false);
+
+	UciEngine engine;
+	std::string line;
+	while (std::getline(std::cin, line))
+		if (!engine.handle(line))
+			break;
+
+	return 0;
+}
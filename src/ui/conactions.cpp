@@ -1,5 +1,9 @@
 #include "../../include/ui/conactions.hpp"
 #include "../../include/ui/conchess.hpp"
+#include "../../include/ai/nnue.hpp"
+#include "../../include/ai/search.hpp"
+#include "../../include/ai/transposition.hpp"
+#include "../../include/ai/tree.hpp"
 #include "../../include/profiler.hpp"
 
 #include <vector>
@@ -8,6 +12,7 @@
 #include <string_view>
 #include <iostream>
 #include <iomanip>
+#include <thread>
 
 namespace actions {
 	bool help(GenericBoard& board, const std::vector<std::string_view>& args) {
@@ -23,6 +28,23 @@ namespace actions {
 		return true;
 	}
 
+	/*
+		Hashes of the positions the console game went through before the current one,
+		so the engine sees the repetitions the board will declare drawn.
+	*/
+	std::vector<uint64_t>& _gameHashes() {
+		static auto& hashes = *new std::vector<uint64_t>();
+		return hashes;
+	}
+
+	/*
+		Hash of the position on the board, 0 when it cannot be searched.
+	*/
+	uint64_t _boardHash(const GenericBoard& board) {
+		SearchPosition position;
+		return position.load(board) ? position.hash() : 0;
+	}
+
 	bool export_moves(GenericBoard& board, const std::vector<std::string_view>& args) {
 		ProfileDeclare;
 		if (args.size() != 1)	return _internalHelp(board, { "export" });
@@ -131,6 +153,7 @@ namespace actions {
 		ProfileDeclare;
 		if (args.size())	return _internalHelp(board, { "restart" });
 		board.initialize();
+		_gameHashes().clear();
 		return true;
 	}
 
@@ -454,10 +477,12 @@ namespace actions {
 			return selected;
 		};
 
+		auto hash = _boardHash(board);
 		if (!board.tryMove(pos, promotion)) {
 			std::cout << "This move cannot be performed. Try again.\n\n";
 			return false;
 		}
+		_gameHashes().push_back(hash);
 		unselect(board, {});
 		turn(board, { "reset" });
 		return true;
@@ -495,13 +520,52 @@ namespace actions {
 
 			return true;
 		}
+		else if (size == 1 && args[0] == "dump") {
+			if (!Profiler::target().size()) {
+				std::cout << "Profiling is not turned on.\n\n";
+				return false;
+			}
+
+			if (Profiler::mode() == ProfileMode::Aggregate)
+				std::cout << Profiler::summary() << "\n";
+			Profiler::flush();
+			std::cout << "Wrote collected metrics into " << Profiler::target() << "\n\n";
+			return false;
+		}
+		else if (size == 2 && args[0] == "sample") {
+			int rate = -1;
+			try {
+				rate = std::stoi(std::string{ args[1] });
+			} catch (std::exception&) {
+				return _internalHelp(board, { "profile" });
+			}
+			if (rate < 1)	return _internalHelp(board, { "profile" });
+
+			Profiler::sampling(rate);
+			return false;
+		}
+		else if (size == 2 && args[0] == "only") {
+			Profiler::include(std::string{ args[1] });
+			return false;
+		}
+		else if (size == 2 && args[0] == "skip") {
+			Profiler::exclude(std::string{ args[1] });
+			return false;
+		}
+		else if (size == 1 && args[0] == "all") {
+			Profiler::clearFilters();
+			return false;
+		}
 		else if (size > 0 && args[0] != "off") {
 			auto rest = std::vector<std::string_view>{ args.begin(), args.end() };
 			if (args[0] == "on")	rest.erase(rest.begin());
-			if (rest.size() > 2) {
+			if (rest.size() > 2 || !rest.size()) {
 				return _internalHelp(board, { "profile" });
 			}
 
+			auto mode = ProfileMode::Text;
+			bool counters = false;
+
 			if (rest.size() > 1) {
 				auto back = rest.back();
 				if (back == "verbose") {
@@ -516,13 +580,236 @@ namespace actions {
 					Profiler::traceback(1);
 					Profiler::verbosity(1);
 				}
+				else if (back == "stats") {
+					Profiler::traceback(0);
+					Profiler::verbosity(0);
+					mode = ProfileMode::Aggregate;
+				}
+				else if (back == "counters") {
+					Profiler::traceback(0);
+					Profiler::verbosity(0);
+					mode = ProfileMode::Aggregate;
+					counters = true;
+				}
+				else if (back == "trace") {
+					Profiler::traceback(0);
+					Profiler::verbosity(0);
+					mode = ProfileMode::Trace;
+				}
+				else if (back == "binary") {
+					Profiler::traceback(0);
+					Profiler::verbosity(0);
+					mode = ProfileMode::Binary;
+				}
+				else if (back == "folded") {
+					Profiler::traceback(0);
+					Profiler::verbosity(0);
+					mode = ProfileMode::Folded;
+				}
 				else return _internalHelp(board, { "profile" });
 			}
 
-			Profiler::target(std::string{ rest[0] });
+			Profiler::counters(counters);
+			Profiler::target(std::string{ rest[0] }, mode);
 			return true;
 		}
 
 		return _internalHelp(board, { "profile" });
 	}
-}
\ No newline at end of file
+
+	/*
+		Network the engine evaluates with, empty for the hand-written evaluation.
+	*/
+	std::unique_ptr<Network>& _network() {
+		static auto& network = *new std::unique_ptr<Network>();
+		return network;
+	}
+
+	bool go(GenericBoard& board, const std::vector<std::string_view>& args) {
+		ProfileDeclare;
+		if (args.size() % 2)	return _internalHelp(board, { "go" });
+		if (board.getWinner() != Color::None) {
+			std::cout << "The game is over, there is nothing to search.\n\n";
+			return false;
+		}
+
+		SearchLimits limits;
+		limits.threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+		bool limited = false;
+
+		for (size_t idx = 0; idx < args.size(); idx += 2) {
+			long long value = 0;
+			try {
+				value = std::stoll(std::string{ args[idx + 1] });
+			} catch (std::invalid_argument&) {
+				return _internalHelp(board, { "go" });
+			} catch (std::out_of_range&) {
+				return _internalHelp(board, { "go" });
+			}
+			if (value <= 0)	return _internalHelp(board, { "go" });
+
+			if (args[idx] == "depth")
+				limits.depth = static_cast<int>(std::min(value, 64LL));
+			else if (args[idx] == "nodes")
+				limits.nodes = static_cast<uint64_t>(value);
+			else if (args[idx] == "time")
+				limits.time = value;
+			else if (args[idx] == "clock")
+				limits.clock.time = value;
+			else if (args[idx] == "inc")
+				limits.clock.increment = value;
+			else if (args[idx] == "movestogo")
+				limits.clock.movesToGo = static_cast<int>(std::min(value, 1000LL));
+			else if (args[idx] == "threads")
+				limits.threads = static_cast<int>(std::min(value, 1024LL));
+			else if (args[idx] == "multipv")
+				limits.multiPv = static_cast<int>(std::min(value, 256LL));
+			else
+				return _internalHelp(board, { "go" });
+
+			//An increment or moves to go mean nothing without a clock
+			limited |= args[idx] == "depth" || args[idx] == "nodes"
+				|| args[idx] == "time" || args[idx] == "clock";
+		}
+
+		if (!limited)
+			limits.time = 3000;
+
+		//Kept between moves, so every search starts with what the last ones found
+		static auto& table = *new TranspositionTable(64);
+		auto search = std::make_unique<Search>(&table);
+		search->useNetwork(_network().get());
+		auto result = search->run(board, limits, [](const SearchResult& result) {
+			std::cout << "depth " << std::setw(2) << result.depth
+				<< "  score " << std::setw(6) << scoreToString(result.score)
+				<< "  nodes " << std::setw(10) << result.nodes
+				<< "  nps " << std::setw(9) << static_cast<uint64_t>(result.nodesPerSecond())
+				<< "  time " << std::fixed << std::setprecision(3) << result.seconds << "s"
+				<< std::defaultfloat << "  pv";
+			for (auto& move : result.pv)
+				std::cout << " " << move.toString();
+			std::cout << "\n";
+
+			//The best line is already printed above
+			for (size_t idx = 1; idx < result.lines.size(); ++idx) {
+				std::cout << std::setw(8) << idx + 1 << "  score "
+					<< std::setw(6) << scoreToString(result.lines[idx].score) << "  pv";
+				for (auto& move : result.lines[idx].pv)
+					std::cout << " " << move.toString();
+				std::cout << "\n";
+			}
+		}, _gameHashes());
+
+		std::cout << "hash hits " << std::fixed << std::setprecision(1) << table.hitRate() * 100
+			<< "%  full " << table.permilleFull() / 10.0
+			<< "%  first move cutoffs " << result.firstMoveCutoffRate() * 100
+			<< "%  pawn hits " << result.pawnHitRate * 100 << "%\n" << std::defaultfloat;
+
+		auto hash = _boardHash(board);
+		if (result.best.isNone() || !playMove(board, result.best)) {
+			std::cout << "The engine found no move to play.\n\n";
+			return false;
+		}
+		_gameHashes().push_back(hash);
+
+		std::cout << "Engine played " << result.best.toString() << ".\n\n";
+		turn(board, { "reset" });
+		return true;
+	}
+
+	bool nnue(GenericBoard& board, const std::vector<std::string_view>& args) {
+		ProfileDeclare;
+		if (args.size() != 1)	return _internalHelp(board, { "nnue" });
+
+		if (args[0] == "off") {
+			_network().reset();
+			std::cout << "The engine evaluates with the hand-written evaluation again.\n\n";
+			return false;
+		}
+
+		auto network = std::make_unique<Network>();
+		if (!network->load(std::string{ args[0] })) {
+			std::cout << "Could not load a network from " << args[0] << ".\n\n";
+			return false;
+		}
+
+		_network() = std::move(network);
+		std::cout << "Loaded the network from " << args[0] << ", accumulators are updated with "
+			<< Network::instructionSet() << ".\n\n";
+		return false;
+	}
+
+	bool mcts(GenericBoard& board, const std::vector<std::string_view>& args) {
+		ProfileDeclare;
+		if (args.size() % 2)	return _internalHelp(board, { "mcts" });
+		if (board.getWinner() != Color::None) {
+			std::cout << "The game is over, there is nothing to search.\n\n";
+			return false;
+		}
+
+		MctsLimits limits;
+		limits.threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+		for (size_t idx = 0; idx < args.size(); idx += 2) {
+			if (args[idx] == "rollout") {
+				if (args[idx + 1] != "random")	return _internalHelp(board, { "mcts" });
+				limits.rollout = Rollout::Random;
+				continue;
+			}
+
+			long long value = 0;
+			try {
+				value = std::stoll(std::string{ args[idx + 1] });
+			} catch (std::invalid_argument&) {
+				return _internalHelp(board, { "mcts" });
+			} catch (std::out_of_range&) {
+				return _internalHelp(board, { "mcts" });
+			}
+			if (value <= 0)	return _internalHelp(board, { "mcts" });
+
+			if (args[idx] == "playouts")
+				limits.playouts = static_cast<uint64_t>(value);
+			else if (args[idx] == "time")
+				limits.time = value;
+			else if (args[idx] == "threads")
+				limits.threads = static_cast<int>(std::min(value, 1024LL));
+			else
+				return _internalHelp(board, { "mcts" });
+		}
+
+		if (!limits.playouts && !limits.time)
+			limits.time = 3000;
+
+		//The pool is allocated once and reused by every search
+		static auto& search = *new MonteCarloSearch(256);
+		search.useNetwork(_network().get());
+		auto result = search.run(board, limits);
+
+		for (size_t idx = 0; idx < std::min<size_t>(result.moves.size(), 5); ++idx) {
+			auto& move = result.moves[idx];
+			std::cout << std::setw(6) << move.move.toString()
+				<< "  visits " << std::setw(9) << move.visits
+				<< "  win " << std::fixed << std::setprecision(1) << move.winRate * 100 << "%\n"
+				<< std::defaultfloat;
+		}
+
+		std::cout << "playouts " << result.playouts
+			<< "  per second " << static_cast<uint64_t>(result.playoutsPerSecond())
+			<< "  per thread " << static_cast<uint64_t>(result.playoutsPerSecondPerThread())
+			<< "  nodes " << result.nodes
+			<< "  memory " << result.memory / 1024 << " KB  pv";
+		for (auto& move : result.pv)
+			std::cout << " " << move.toString();
+		std::cout << "\n";
+
+		auto hash = _boardHash(board);
+		if (result.best.isNone() || !playMove(board, result.best)) {
+			std::cout << "The engine found no move to play.\n\n";
+			return false;
+		}
+		_gameHashes().push_back(hash);
+
+		std::cout << "Engine played " << result.best.toString() << ".\n\n";
+		turn(board, { "reset" });
+		return true;
+	}
+}